@@ -0,0 +1,607 @@
+/**
+ * @file HtmlScanner.cpp
+ * @author Santino Nastasi
+ * @author Camila Castro
+ * @brief Extracts the indexable text of an HTML page
+ * @version 0.1
+ *
+ * A single pass over the page driven by lookup tables built at compile time.
+ * Runs of plain text are copied whole, entities are decoded to UTF-8, block
+ * level tags become separators and script/style bodies and comments are
+ * skipped by a scanner specialized for each of them.
+ *
+ * @copyright Copyright (c) 2022-2024 Marc S. Ressl
+ */
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#include "HtmlScanner.h"
+
+using namespace std;
+
+#define MAX_TAG_NAME 15
+#define MAX_ENTITY_NAME 15
+// Enough for U+10FFFF written in decimal
+#define MAX_ENTITY_DIGITS 7
+
+enum CharClass : uint8_t
+{
+    CHAR_TEXT,
+    CHAR_TAG,
+    CHAR_ENTITY,
+};
+
+enum TagKind
+{
+    TAG_INLINE,
+    TAG_BLOCK,
+    TAG_SCRIPT,
+    TAG_STYLE,
+    TAG_COMMENT,
+};
+
+struct TagName
+{
+    const char *name;
+    TagKind kind;
+};
+
+struct NamedEntity
+{
+    const char *name;
+    uint32_t codepoint;
+};
+
+static constexpr array<uint8_t, 256> makeTextClasses()
+{
+    array<uint8_t, 256> classes{};
+    classes['<'] = CHAR_TAG;
+    classes['&'] = CHAR_ENTITY;
+
+    return classes;
+}
+
+/**
+ * @brief ASCII letters and digits, lowercased. 0 for every other byte.
+ */
+static constexpr array<char, 256> makeNameChars()
+{
+    array<char, 256> chars{};
+    for (int c = 0; c < 256; c++)
+    {
+        if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9'))
+            chars[c] = (char)c;
+        else if (c >= 'A' && c <= 'Z')
+            chars[c] = (char)(c - 'A' + 'a');
+    }
+
+    return chars;
+}
+
+/**
+ * @brief value of a hexadecimal digit, 0xFF for every other byte.
+ */
+static constexpr array<uint8_t, 256> makeDigitValues()
+{
+    array<uint8_t, 256> values{};
+    for (int c = 0; c < 256; c++)
+    {
+        if (c >= '0' && c <= '9')
+            values[c] = (uint8_t)(c - '0');
+        else if (c >= 'a' && c <= 'f')
+            values[c] = (uint8_t)(c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F')
+            values[c] = (uint8_t)(c - 'A' + 10);
+        else
+            values[c] = 0xFF;
+    }
+
+    return values;
+}
+
+static constexpr array<uint8_t, 256> textClasses = makeTextClasses();
+static constexpr array<char, 256> nameChars = makeNameChars();
+static constexpr array<uint8_t, 256> digitValues = makeDigitValues();
+
+// Tags that are not inline
+static constexpr TagName tagNames[] = {
+    {"address", TAG_BLOCK},
+    {"article", TAG_BLOCK},
+    {"blockquote", TAG_BLOCK},
+    {"br", TAG_BLOCK},
+    {"caption", TAG_BLOCK},
+    {"dd", TAG_BLOCK},
+    {"div", TAG_BLOCK},
+    {"dl", TAG_BLOCK},
+    {"dt", TAG_BLOCK},
+    {"figcaption", TAG_BLOCK},
+    {"figure", TAG_BLOCK},
+    {"footer", TAG_BLOCK},
+    {"h1", TAG_BLOCK},
+    {"h2", TAG_BLOCK},
+    {"h3", TAG_BLOCK},
+    {"h4", TAG_BLOCK},
+    {"h5", TAG_BLOCK},
+    {"h6", TAG_BLOCK},
+    {"header", TAG_BLOCK},
+    {"hr", TAG_BLOCK},
+    {"li", TAG_BLOCK},
+    {"nav", TAG_BLOCK},
+    {"ol", TAG_BLOCK},
+    {"option", TAG_BLOCK},
+    {"p", TAG_BLOCK},
+    {"pre", TAG_BLOCK},
+    {"script", TAG_SCRIPT},
+    {"section", TAG_BLOCK},
+    {"style", TAG_STYLE},
+    {"table", TAG_BLOCK},
+    {"tbody", TAG_BLOCK},
+    {"td", TAG_BLOCK},
+    {"tfoot", TAG_BLOCK},
+    {"th", TAG_BLOCK},
+    {"thead", TAG_BLOCK},
+    {"title", TAG_BLOCK},
+    {"tr", TAG_BLOCK},
+    {"ul", TAG_BLOCK},
+};
+
+// Named entities, numeric ones are decoded directly
+static constexpr NamedEntity namedEntities[] = {
+    {"Aacute", 0xC1},
+    {"Eacute", 0xC9},
+    {"Iacute", 0xCD},
+    {"Ntilde", 0xD1},
+    {"Oacute", 0xD3},
+    {"Uacute", 0xDA},
+    {"Uuml", 0xDC},
+    {"aacute", 0xE1},
+    {"amp", '&'},
+    {"apos", '\''},
+    {"bull", 0x2022},
+    {"ccedil", 0xE7},
+    {"copy", 0xA9},
+    {"deg", 0xB0},
+    {"eacute", 0xE9},
+    {"euro", 0x20AC},
+    {"gt", '>'},
+    {"hellip", 0x2026},
+    {"iacute", 0xED},
+    {"iexcl", 0xA1},
+    {"iquest", 0xBF},
+    {"laquo", 0xAB},
+    {"ldquo", 0x201C},
+    {"lsquo", 0x2018},
+    {"lt", '<'},
+    {"mdash", 0x2014},
+    {"middot", 0xB7},
+    {"nbsp", 0xA0},
+    {"ndash", 0x2013},
+    {"ntilde", 0xF1},
+    {"oacute", 0xF3},
+    {"ordf", 0xAA},
+    {"ordm", 0xBA},
+    {"quot", '"'},
+    {"raquo", 0xBB},
+    {"rdquo", 0x201D},
+    {"reg", 0xAE},
+    {"rsquo", 0x2019},
+    {"uacute", 0xFA},
+    {"uuml", 0xFC},
+};
+
+// Slots of the hash tables of tag and entity names, a power of two
+#define NAME_TABLE_SIZE 128
+
+static constexpr uint32_t addNameHash(uint32_t hash, char c)
+{
+    return hash * 31 + (unsigned char)c;
+}
+
+static constexpr uint32_t hashName(const char *name)
+{
+    uint32_t hash = 0;
+    while (*name)
+        hash = addNameHash(hash, *name++);
+
+    return hash;
+}
+
+/**
+ * @brief open addressing hash table over one of the name tables. Each slot
+ * holds the index of its entry plus one, 0 marks an empty slot.
+ */
+template <typename T, size_t N>
+static constexpr array<uint8_t, NAME_TABLE_SIZE> makeNameTable(const T (&entries)[N])
+{
+    static_assert(N < NAME_TABLE_SIZE / 2, "name table too full");
+
+    array<uint8_t, NAME_TABLE_SIZE> slots{};
+    for (size_t i = 0; i < N; i++)
+    {
+        uint32_t slot = hashName(entries[i].name) & (NAME_TABLE_SIZE - 1);
+        while (slots[slot])
+            slot = (slot + 1) & (NAME_TABLE_SIZE - 1);
+
+        slots[slot] = (uint8_t)(i + 1);
+    }
+
+    return slots;
+}
+
+static constexpr array<uint8_t, NAME_TABLE_SIZE> tagSlots = makeNameTable(tagNames);
+static constexpr array<uint8_t, NAME_TABLE_SIZE> entitySlots = makeNameTable(namedEntities);
+
+/**
+ * @brief looks a name up in one of the name tables.
+ *
+ * @param hash hashName(name), computed while the name was read
+ * @return the entry, or NULL if the name is not in the table
+ */
+template <typename T, size_t N>
+static const T *findByName(const T (&entries)[N],
+                           const array<uint8_t, NAME_TABLE_SIZE> &slots,
+                           const char *name,
+                           uint32_t hash)
+{
+    for (uint32_t slot = hash & (NAME_TABLE_SIZE - 1);
+         slots[slot];
+         slot = (slot + 1) & (NAME_TABLE_SIZE - 1))
+    {
+        const T &entry = entries[slots[slot] - 1];
+        if (!strcmp(entry.name, name))
+            return &entry;
+    }
+
+    return NULL;
+}
+
+static inline char toLowercase(char c)
+{
+    char nameChar = nameChars[(unsigned char)c];
+
+    return nameChar ? nameChar : c;
+}
+
+/**
+ * @brief elements whose content is not text, and the marker that ends them.
+ */
+template <TagKind kind>
+struct SkippedElement;
+
+template <>
+struct SkippedElement<TAG_SCRIPT>
+{
+    static constexpr const char end[] = "</script";
+    // The end marker is the start of a tag, skipped up to its '>'
+    static constexpr bool endsInTag = true;
+};
+
+template <>
+struct SkippedElement<TAG_STYLE>
+{
+    static constexpr const char end[] = "</style";
+    static constexpr bool endsInTag = true;
+};
+
+template <>
+struct SkippedElement<TAG_COMMENT>
+{
+    static constexpr const char end[] = "-->";
+    static constexpr bool endsInTag = false;
+};
+
+/**
+ * @brief skips the content of a script, style or comment, and its end.
+ *
+ * @param html the page
+ * @param size size of the page
+ * @param i where the content starts
+ * @return where the text after the element starts
+ */
+template <TagKind kind>
+static size_t skipElement(const char *html, size_t size, size_t i)
+{
+    typedef SkippedElement<kind> Element;
+    const size_t length = sizeof(Element::end) - 1;
+
+    while (true)
+    {
+        const char *found = (const char *)memchr(html + i, Element::end[0], size - i);
+        if (!found)
+            return size;
+
+        i = found - html;
+        if (size - i < length)
+            return size;
+
+        // Tag names match in any case, as in </SCRIPT>.
+        size_t matched = 1;
+        while (matched < length && toLowercase(html[i + matched]) == Element::end[matched])
+            matched++;
+
+        if (matched == length)
+            break;
+
+        i++;
+    }
+
+    i += length;
+    if (!Element::endsInTag)
+        return i;
+
+    const char *close = (const char *)memchr(html + i, '>', size - i);
+
+    return close ? close - html + 1 : size;
+}
+
+/**
+ * @brief checks if any byte of a word is c.
+ */
+static inline bool hasByte(uint64_t word, unsigned char c)
+{
+    uint64_t x = word ^ (0x0101010101010101ULL * c);
+
+    return ((x - 0x0101010101010101ULL) & ~x & 0x8080808080808080ULL) != 0;
+}
+
+static void appendUtf8(string &text, uint32_t codepoint)
+{
+    if (codepoint < 0x80)
+        text += (char)codepoint;
+    else if (codepoint < 0x800)
+    {
+        text += (char)(0xC0 | (codepoint >> 6));
+        text += (char)(0x80 | (codepoint & 0x3F));
+    }
+    else if (codepoint < 0x10000)
+    {
+        text += (char)(0xE0 | (codepoint >> 12));
+        text += (char)(0x80 | ((codepoint >> 6) & 0x3F));
+        text += (char)(0x80 | (codepoint & 0x3F));
+    }
+    else
+    {
+        text += (char)(0xF0 | (codepoint >> 18));
+        text += (char)(0x80 | ((codepoint >> 12) & 0x3F));
+        text += (char)(0x80 | ((codepoint >> 6) & 0x3F));
+        text += (char)(0x80 | (codepoint & 0x3F));
+    }
+}
+
+/**
+ * @brief decodes the entity at html[i], which is a '&'. Anything that is
+ * not a well formed entity is kept as text.
+ *
+ * @return where the text after the entity starts
+ */
+static size_t decodeEntity(const char *html, size_t size, size_t i, string &text)
+{
+    size_t j = i + 1;
+    uint32_t codepoint = 0;
+
+    if (j < size && html[j] == '#')
+    {
+        j++;
+        unsigned int base = 10;
+        if (j < size && (html[j] == 'x' || html[j] == 'X'))
+        {
+            base = 16;
+            j++;
+        }
+
+        size_t digits = 0;
+        while (j < size && digits < MAX_ENTITY_DIGITS && digitValues[(unsigned char)html[j]] < base)
+        {
+            codepoint = codepoint * base + digitValues[(unsigned char)html[j]];
+            digits++;
+            j++;
+        }
+
+        bool isValid = digits && codepoint && codepoint <= 0x10FFFF &&
+                       (codepoint < 0xD800 || codepoint > 0xDFFF);
+        if (!isValid || j >= size || html[j] != ';')
+        {
+            text += '&';
+            return i + 1;
+        }
+    }
+    else
+    {
+        // Entity names are case sensitive, so they are not lowercased.
+        char name[MAX_ENTITY_NAME + 1];
+        size_t length = 0;
+        uint32_t hash = 0;
+        while (j < size && length < MAX_ENTITY_NAME && nameChars[(unsigned char)html[j]])
+        {
+            hash = addNameHash(hash, html[j]);
+            name[length++] = html[j++];
+        }
+        name[length] = '\0';
+
+        const NamedEntity *entity = NULL;
+        if (length && j < size && html[j] == ';')
+            entity = findByName(namedEntities, entitySlots, name, hash);
+
+        if (!entity)
+        {
+            text += '&';
+            return i + 1;
+        }
+
+        codepoint = entity->codepoint;
+    }
+
+    appendUtf8(text, codepoint);
+
+    return j + 1;
+}
+
+/**
+ * @brief finds the '>' that ends a tag. Quoted attribute values are skipped,
+ * as in <a title="x>y">; an unterminated one ends at its first '>'.
+ *
+ * @param html the page
+ * @param size size of the page
+ * @param j where the attributes start
+ * @return the position of the '>', or size if the tag is not closed
+ */
+static size_t findTagEnd(const char *html, size_t size, size_t j)
+{
+    while (j < size)
+    {
+        char c = html[j++];
+        if (c == '>')
+            return j - 1;
+        if (c != '=')
+            continue;
+
+        while (j < size && (html[j] == ' ' || html[j] == '\t' || html[j] == '\n' ||
+                            html[j] == '\r' || html[j] == '\f'))
+            j++;
+
+        if (j < size && (html[j] == '"' || html[j] == '\''))
+        {
+            const char *quote = (const char *)memchr(html + j + 1, html[j], size - j - 1);
+            if (!quote)
+                break;
+
+            j = quote - html + 1;
+        }
+    }
+
+    const char *close = (const char *)memchr(html + j, '>', size - j);
+
+    return close ? close - html : size;
+}
+
+/**
+ * @brief adds a word separator, unless the text already ends in one.
+ */
+static void separateWords(string &text)
+{
+    if (!text.empty() && text.back() != ' ')
+        text += ' ';
+}
+
+/**
+ * @brief handles the markup starting at html[i], which is a '<'.
+ *
+ * @return where the text after the markup starts
+ */
+static size_t scanTag(const char *html, size_t size, size_t i, string &text)
+{
+    size_t j = i + 1;
+    if (j >= size)
+        return size;
+
+    if (html[j] == '!')
+    {
+        // Comments separate words, as in uno<!-- -->dos.
+        if (size - j >= 3 && html[j + 1] == '-' && html[j + 2] == '-')
+        {
+            separateWords(text);
+            return skipElement<TAG_COMMENT>(html, size, j + 3);
+        }
+    }
+    else if (html[j] != '?')
+    {
+        bool isClosing = (html[j] == '/');
+        if (isClosing)
+            j++;
+
+        // A '<' not followed by a tag name is just text, as in "a < b".
+        if (j >= size || !nameChars[(unsigned char)html[j]] || (html[j] >= '0' && html[j] <= '9'))
+        {
+            text += '<';
+            return i + 1;
+        }
+
+        char name[MAX_TAG_NAME + 1];
+        size_t length = 0;
+        uint32_t hash = 0;
+        while (j < size && nameChars[(unsigned char)html[j]])
+        {
+            if (length < MAX_TAG_NAME)
+            {
+                name[length++] = nameChars[(unsigned char)html[j]];
+                hash = addNameHash(hash, nameChars[(unsigned char)html[j]]);
+            }
+            j++;
+        }
+        name[length] = '\0';
+
+        size_t close = findTagEnd(html, size, j);
+        if (close == size)
+            return size;
+
+        size_t end = close + 1;
+        bool isSelfClosing = (html[close - 1] == '/');
+
+        const TagName *tag = findByName(tagNames, tagSlots, name, hash);
+        TagKind kind = tag ? tag->kind : TAG_INLINE;
+
+        if (kind == TAG_SCRIPT && !isClosing && !isSelfClosing)
+            return skipElement<TAG_SCRIPT>(html, size, end);
+        if (kind == TAG_STYLE && !isClosing && !isSelfClosing)
+            return skipElement<TAG_STYLE>(html, size, end);
+
+        // Block tags separate words, as in <td>uno</td><td>dos</td>.
+        if (kind != TAG_INLINE)
+            separateWords(text);
+
+        return end;
+    }
+
+    // Doctype, CDATA and processing instructions.
+    const char *close = (const char *)memchr(html + j, '>', size - j);
+
+    return close ? close - html + 1 : size;
+}
+
+/**
+ * @brief extracts the text of a page: tags are removed, entities decoded and
+ * scripts, styles and comments dropped.
+ *
+ * @param html the page
+ * @return the text, UTF-8 encoded
+ */
+string extractHtmlText(const string &htmlText)
+{
+    const char *html = htmlText.data();
+    size_t size = htmlText.size();
+
+    string text;
+    text.reserve(size / 2);
+
+    size_t i = 0;
+    while (i < size)
+    {
+        size_t start = i;
+
+        // Fast path: eight bytes at a time while there is no markup.
+        while (size - i >= 8)
+        {
+            uint64_t word;
+            memcpy(&word, html + i, sizeof(word));
+            if (hasByte(word, '<') || hasByte(word, '&'))
+                break;
+            i += 8;
+        }
+
+        while (i < size && textClasses[(unsigned char)html[i]] == CHAR_TEXT)
+            i++;
+
+        text.append(html + start, i - start);
+        if (i == size)
+            break;
+
+        if (textClasses[(unsigned char)html[i]] == CHAR_ENTITY)
+            i = decodeEntity(html, size, i, text);
+        else
+            i = scanTag(html, size, i, text);
+    }
+
+    return text;
+}
@@ -0,0 +1,18 @@
+/**
+ * @file HtmlScanner.h
+ * @author Santino Nastasi
+ * @author Camila Castro
+ * @brief Extracts the indexable text of an HTML page
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2022-2024 Marc S. Ressl
+ */
+
+#ifndef HTMLSCANNER_H
+#define HTMLSCANNER_H
+
+#include <string>
+
+std::string extractHtmlText(const std::string &html);
+
+#endif
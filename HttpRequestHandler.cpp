@@ -4,50 +4,63 @@
  * @author Santino Nastasi
  * @author Camila Castro
  * @brief EDAoggle search engine
- * @version 0.3
+ * @version 0.4
  *
  * @copyright Copyright (c) 2022-2024 Marc S. Ressl
  */
 
+#include <cctype>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
-#include <sqlite3.h>
 #include <chrono>
 
 #include "HttpRequestHandler.h"
+#include "IndexShards.h"
 
 using namespace std;
 
-HttpRequestHandler::HttpRequestHandler(string homePath)
+/**
+ * @brief Lists the database files of an index split in shardCount shards
+ *
+ * @param shardCount The amount of shards, 1 for a single index.db
+ * @return The database files
+ */
+static vector<string> getDatabaseFiles(int shardCount)
+{
+    vector<string> databaseFiles;
+    for (int shard = 0; shard < shardCount; shard++)
+        databaseFiles.push_back(getShardDatabaseFile(shard, shardCount));
+
+    return databaseFiles;
+}
+
+HttpRequestHandler::HttpRequestHandler(string homePath, int shardCount)
+    : searchEngine(getDatabaseFiles(shardCount))
 {
     this->homePath = homePath;
+    queryLog = NULL;
+    maxResults = 0;
 }
 
 /**
- * @brief callback function that works with database response to query. In this case, saves the page names to list.
+ * @brief Limits the results shown per search, 0 shows them all
  *
- * @param list pointer to our list
- * @param argc argc amount of columns in the response
- * @param argv list with the string of each row
- * @param azColName list with the string of each rows name
- * @return 0 if no problems occur
+ * @param maxResults The maximum amount of results
  */
-static int databaseResponse(void *list,
-                            int argc,
-                            char **argv,
-                            char **azColName)
+void HttpRequestHandler::setMaxResults(size_t maxResults)
 {
+    this->maxResults = maxResults;
+}
 
-    // Saves the first colum (only one) in list.
-    if (argv[0])
-    {
-        string page = "https://es.wikipedia.org/wiki/";
-        page += argv[0];
-        ((vector<string> *)list)->push_back(page);
-    }
-
-    return 0;
+/**
+ * @brief Sets the log where served queries are recorded, NULL disables logging
+ *
+ * @param queryLog The query log
+ */
+void HttpRequestHandler::setQueryLog(QueryLog *queryLog)
+{
+    this->queryLog = queryLog;
 }
 
 /**
@@ -86,6 +99,56 @@ bool HttpRequestHandler::serve(string url, vector<char> &response)
     return true;
 }
 
+/**
+ * @brief escapes a string so it can be placed inside a quoted HTML attribute.
+ *
+ * @param value the string
+ * @return the escaped string
+ */
+static string escapeAttribute(const string &value)
+{
+    string escaped;
+    for (char c : value)
+    {
+        if (c == '"')
+            escaped += "&quot;";
+        else if (c == '&')
+            escaped += "&amp;";
+        else if (c == '<')
+            escaped += "&lt;";
+        else
+            escaped += c;
+    }
+
+    return escaped;
+}
+
+/**
+ * @brief percent-encodes a query so it can be placed in a link.
+ *
+ * @param value the query
+ * @return the encoded query
+ */
+static string encodeUrl(const string &value)
+{
+    const char *hex = "0123456789ABCDEF";
+    string encoded;
+
+    for (unsigned char c : value)
+    {
+        if (isalnum(c) || c == '-' || c == '_' || c == '.')
+            encoded += c;
+        else
+        {
+            encoded += '%';
+            encoded += hex[c >> 4];
+            encoded += hex[c & 0xF];
+        }
+    }
+
+    return encoded;
+}
+
 bool HttpRequestHandler::handleRequest(string url,
                                        HttpArguments arguments,
                                        vector<char> &response)
@@ -115,11 +178,11 @@ bool HttpRequestHandler::handleRequest(string url,
     <article class=\"edaoogle\">\
         <div class=\"title\"><a href=\"/\">EDAoogle</a></div>\
         <div class=\"disclaimer_title\">Logical operators</div>\
-        <div class=\"disclaimer_info\">~ (NOT) ; | (OR) ; & (AND)</div>\
+        <div class=\"disclaimer_info\">~ (NOT) ; | (OR) ; & (AND) ; \"...\" (PHRASE) ; NEAR/k</div>\
         <div class=\"search\">\
             <form action=\"/search\" method=\"get\">\
                 <input type=\"text\" name=\"q\" value=\"" +
-                                       searchString + "\" autofocus>\
+                                       escapeAttribute(searchString) + "\" autofocus>\
             </form>\
         </div>\
         ");
@@ -127,68 +190,65 @@ bool HttpRequestHandler::handleRequest(string url,
         // YOUR JOB: fill in results
         float searchTime = 0.1F;
         vector<string> results;
-
-        char *databaseFile = (char *)"index.db";
-        sqlite3 *database;
-        char *databaseErrorMessage;
+        SearchStats stats;
 
         auto start = chrono::high_resolution_clock::now();
 
-        // Open database file
-        if (sqlite3_open(databaseFile, &database) != SQLITE_OK)
-        {
-            cout << "Can't open database: " << sqlite3_errmsg(database) << endl;
-
+        if (!searchEngine.search(searchString, results, &stats, maxResults))
             return false;
-        }
 
-        // Includes Operators, & = AND, | = OR, ~ = NOT. and takes out problematic simbols.
-        string newSearchString;
-        for (unsigned char simbol : searchString)
+        // Few results may come from a typo: suggest a correction, and if
+        // nothing was found at all, search for the correction instead.
+        // A search cut at maxResults found more, however small maxResults is.
+        // The log keeps the query as typed, with the time of both searches.
+        string suggestion;
+        bool isCorrected = false;
+        if (!stats.isTruncated && results.size() < SUGGESTION_MAX_RESULTS)
         {
-            if (simbol == '&')
-            {
-                newSearchString += " AND ";
-            }
-            else if (simbol == '|')
-            {
-                newSearchString += " OR ";
-            }
-            else if (simbol == '~')
-            {
-                newSearchString += " NOT ";
-            }
-            else if (simbol == 32 || (simbol > 47 && simbol < 57) || (simbol > 64 && simbol < 123) || (simbol > 127 && simbol < 166))
+            auto suggestStart = chrono::high_resolution_clock::now();
+            bool isSuggested = searchEngine.suggest(searchString, suggestion);
+            stats.suggestMicros = (uint32_t)chrono::duration_cast<chrono::microseconds>(
+                                      chrono::high_resolution_clock::now() - suggestStart)
+                                      .count();
+
+            if (isSuggested && results.empty())
             {
-                newSearchString += simbol;
-            }
-        }
+                isCorrected = true;
 
-        // Command to search with fts.
-        string sqlCommand = "SELECT page_name from wiki_pages_fts WHERE wiki_pages_fts MATCH '" + newSearchString + "'";
+                SearchStats correctedStats;
+                if (!searchEngine.search(suggestion, results, &correctedStats, maxResults))
+                    return false;
 
-        if (sqlite3_exec(database,
-                         sqlCommand.c_str(),
-                         databaseResponse,
-                         &results,
-                         &databaseErrorMessage) != SQLITE_OK)
-        {
-            cout << "Error: " << sqlite3_errmsg(database) << endl;
+                stats.parseMicros += correctedStats.parseMicros;
+                stats.openMicros += correctedStats.openMicros;
+                stats.evaluateMicros += correctedStats.evaluateMicros;
+                stats.fetchMicros += correctedStats.fetchMicros;
+            }
         }
 
-        // Close database
-        sqlite3_close(database);
-
         auto stop = chrono::high_resolution_clock::now();
 
         searchTime = chrono::duration_cast<chrono::milliseconds>(stop - start).count() / 1000.0F;
 
+        if (!suggestion.empty())
+        {
+            string link = "<a href=\"/search?q=" + encodeUrl(suggestion) + "\">" +
+                          escapeAttribute(suggestion) + "</a>";
+            if (isCorrected)
+                responseString += "<div class=\"suggestion\">Showing results for " + link + "</div>";
+            else
+                responseString += "<div class=\"suggestion\">Did you mean " + link + "?</div>";
+        }
+
         // Print search results (add target= "_blank" in the href so it opens up in a new tab)
         responseString += "<div class=\"results\">" + to_string(results.size()) +
                           " results (" + to_string(searchTime) + " seconds):</div>";
         for (auto &result : results)
+        {
+            string link = "https://es.wikipedia.org/wiki/" + result;
             responseString += "<div class=\"result\"><a href=\"" +
-                              result + "\" target=\"_blank\">" + result + "</a></div>";
+                              link + "\" target=\"_blank\">" + link + "</a></div>";
+        }
 
         // Trailer
         responseString += "    </article>\
@@ -197,6 +257,26 @@ bool HttpRequestHandler::handleRequest(string url,
 
         response.assign(responseString.begin(), responseString.end());
 
+        if (queryLog)
+        {
+            auto end = chrono::high_resolution_clock::now();
+
+            QueryLogEntry entry;
+            entry.timestamp = chrono::duration_cast<chrono::microseconds>(
+                                  chrono::system_clock::now().time_since_epoch())
+                                  .count();
+            entry.resultCount = (uint32_t)results.size();
+            entry.parseMicros = stats.parseMicros;
+            entry.openMicros = stats.openMicros;
+            entry.evaluateMicros = stats.evaluateMicros;
+            entry.fetchMicros = stats.fetchMicros;
+            entry.suggestMicros = stats.suggestMicros;
+            entry.totalMicros = (uint32_t)chrono::duration_cast<chrono::microseconds>(end - start).count();
+            setQueryLogText(entry, stats.normalizedQuery);
+
+            queryLog->record(entry);
+        }
+
         return true;
     }
     else
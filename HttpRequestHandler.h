@@ -11,18 +11,25 @@
 #define HTTPREQUESTHANDLER_H
 
 #include "HttpServer.h"
+#include "QueryLog.h"
+#include "SearchEngine.h"
 
 class HttpRequestHandler
 {
 public:
-    HttpRequestHandler(std::string homePath);
+    HttpRequestHandler(std::string homePath, int shardCount = 1);
 
     bool handleRequest(std::string url, HttpArguments arguments, std::vector<char> &response);
+    void setQueryLog(QueryLog *queryLog);
+    void setMaxResults(size_t maxResults);
 
 private:
     bool serve(std::string path, std::vector<char> &response);
 
     std::string homePath;
+    SearchEngine searchEngine;
+    QueryLog *queryLog;
+    size_t maxResults;
 };
 
 #endif
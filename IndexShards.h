@@ -0,0 +1,52 @@
+/**
+ * @file IndexShards.h
+ * @author Santino Nastasi
+ * @author Camila Castro
+ * @brief Partitioning of the index into shard files
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2022-2024 Marc S. Ressl
+ */
+
+#ifndef INDEXSHARDS_H
+#define INDEXSHARDS_H
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief database file of a shard. An unsharded index is a single index.db.
+ *
+ * @param shard the shard number, from 0 to shardCount - 1
+ * @param shardCount amount of shards
+ * @return the file name
+ */
+inline std::string getShardDatabaseFile(int shard, int shardCount)
+{
+    if (shardCount <= 1)
+        return "index.db";
+
+    return "index-" + std::to_string(shard) + ".db";
+}
+
+/**
+ * @brief shard a page belongs to, from the FNV-1a hash of its file name.
+ * Stable across runs and platforms, so a shard can be rebuilt on its own.
+ *
+ * @param fileName file name of the page
+ * @param shardCount amount of shards
+ * @return the shard number
+ */
+inline int getPageShard(const std::string &fileName, int shardCount)
+{
+    uint32_t hash = 2166136261u;
+    for (unsigned char c : fileName)
+    {
+        hash ^= c;
+        hash *= 16777619u;
+    }
+
+    return (int)(hash % (uint32_t)shardCount);
+}
+
+#endif
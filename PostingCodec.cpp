@@ -0,0 +1,171 @@
+/**
+ * @file PostingCodec.cpp
+ * @author Santino Nastasi
+ * @author Camila Castro
+ * @brief Compressed encoding of index lists
+ * @version 0.2
+ *
+ * @copyright Copyright (c) 2022-2024 Marc S. Ressl
+ */
+
+#include "PostingCodec.h"
+
+using namespace std;
+
+/**
+ * @brief appends a value using 7 bits per byte, the high bit marks that more bytes follow.
+ *
+ * @param buffer where the bytes are appended
+ * @param value the value to write
+ */
+void writeVarint(string &buffer, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        buffer += (char)((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+
+    buffer += (char)value;
+}
+
+/**
+ * @brief reads a value written by writeVarint.
+ *
+ * @param data the encoded bytes
+ * @param size amount of encoded bytes
+ * @param offset where to read from, advanced past the value
+ * @param value the value read
+ * @return false if the data ends before the value does
+ */
+bool readVarint(const unsigned char *data, size_t size, size_t &offset, uint32_t &value)
+{
+    value = 0;
+
+    for (int shift = 0; offset < size && shift < 32; shift += 7)
+    {
+        unsigned char byte = data[offset++];
+        value |= (uint32_t)(byte & 0x7F) << shift;
+
+        if (!(byte & 0x80))
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief encodes a sorted list of term positions as varint deltas.
+ *
+ * @param positions sorted term positions inside a page
+ * @return the encoded list
+ */
+string encodePositions(const vector<uint32_t> &positions)
+{
+    string buffer;
+    uint32_t previous = 0;
+
+    for (uint32_t position : positions)
+    {
+        writeVarint(buffer, position - previous);
+        previous = position;
+    }
+
+    return buffer;
+}
+
+/**
+ * @brief decodes a list written by encodePositions.
+ *
+ * @param data the encoded bytes
+ * @param size amount of encoded bytes
+ * @return the sorted term positions
+ */
+vector<uint32_t> decodePositions(const void *data, size_t size)
+{
+    vector<uint32_t> positions;
+    const unsigned char *bytes = (const unsigned char *)data;
+
+    size_t offset = 0;
+    uint32_t position = 0;
+    uint32_t delta;
+    while (readVarint(bytes, size, offset, delta))
+    {
+        position += delta;
+        positions.push_back(position);
+    }
+
+    return positions;
+}
+
+/**
+ * @brief encodes the sorted pages containing a term in blocks of blockSize pages.
+ * A skip table in front stores the first and last page of every block, so a
+ * reader can jump straight to the block that may contain a given page.
+ *
+ * Layout: kind, page count, block count, skip table (first page delta, last
+ * page delta, page count and byte length per block), block data (page deltas).
+ *
+ * @param pages sorted pages containing the term
+ * @param blockSize pages per block
+ * @return the encoded list
+ */
+string encodeBlockPostings(const vector<uint32_t> &pages, size_t blockSize)
+{
+    string skipTable;
+    string blockData;
+    uint32_t previousLast = 0;
+    size_t blockCount = 0;
+
+    for (size_t start = 0; start < pages.size(); start += blockSize)
+    {
+        size_t end = start + blockSize;
+        if (end > pages.size())
+            end = pages.size();
+
+        string block;
+        for (size_t i = start + 1; i < end; i++)
+            writeVarint(block, pages[i] - pages[i - 1]);
+
+        writeVarint(skipTable, pages[start] - previousLast);
+        writeVarint(skipTable, pages[end - 1] - pages[start]);
+        writeVarint(skipTable, (uint32_t)(end - start));
+        writeVarint(skipTable, (uint32_t)block.size());
+
+        blockData += block;
+        previousLast = pages[end - 1];
+        blockCount++;
+    }
+
+    string buffer;
+    writeVarint(buffer, POSTINGS_BLOCKS);
+    writeVarint(buffer, (uint32_t)pages.size());
+    writeVarint(buffer, (uint32_t)blockCount);
+
+    return buffer + skipTable + blockData;
+}
+
+/**
+ * @brief encodes the sorted pages containing a term as one bit per page.
+ * Smaller than blocks for terms that appear in a large share of the pages.
+ *
+ * Layout: kind, page count, bitset (bit n of byte n / 8 set if page n is present).
+ *
+ * @param pages sorted pages containing the term
+ * @return the encoded list
+ */
+string encodeBitsetPostings(const vector<uint32_t> &pages)
+{
+    string buffer;
+    writeVarint(buffer, POSTINGS_BITSET);
+    writeVarint(buffer, (uint32_t)pages.size());
+
+    size_t headerSize = buffer.size();
+    if (!pages.empty())
+        buffer.resize(headerSize + pages.back() / 8 + 1, 0);
+
+    for (uint32_t page : pages)
+        buffer[headerSize + page / 8] |= (char)(1 << (page % 8));
+
+    return buffer;
+}
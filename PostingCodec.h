@@ -0,0 +1,31 @@
+/**
+ * @file PostingCodec.h
+ * @author Santino Nastasi
+ * @author Camila Castro
+ * @brief Compressed encoding of index lists
+ * @version 0.2
+ *
+ * @copyright Copyright (c) 2022-2024 Marc S. Ressl
+ */
+
+#ifndef POSTINGCODEC_H
+#define POSTINGCODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+void writeVarint(std::string &buffer, uint32_t value);
+bool readVarint(const unsigned char *data, size_t size, size_t &offset, uint32_t &value);
+
+std::string encodePositions(const std::vector<uint32_t> &positions);
+std::vector<uint32_t> decodePositions(const void *data, size_t size);
+
+#define POSTINGS_BLOCKS 0
+#define POSTINGS_BITSET 1
+
+std::string encodeBlockPostings(const std::vector<uint32_t> &pages, size_t blockSize);
+std::string encodeBitsetPostings(const std::vector<uint32_t> &pages);
+
+#endif
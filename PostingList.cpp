@@ -0,0 +1,172 @@
+/**
+ * @file PostingList.cpp
+ * @author Santino Nastasi
+ * @author Camila Castro
+ * @brief Reads the pages containing a term, skipping over whole blocks
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2022-2024 Marc S. Ressl
+ */
+
+#include <algorithm>
+
+#include "PostingCodec.h"
+#include "PostingList.h"
+
+using namespace std;
+
+PostingList::PostingList()
+{
+    count = 0;
+    current = 0;
+    isBitset = false;
+    bitsetOffset = 0;
+    blockIndex = 0;
+    decodedBlock = SIZE_MAX;
+    pageIndex = 0;
+}
+
+/**
+ * @brief loads a list written by encodeBlockPostings or encodeBitsetPostings.
+ * Only the skip table is decoded here, blocks are decoded when reached.
+ *
+ * @param data the encoded bytes
+ * @param size amount of encoded bytes
+ * @return false if the list is corrupt
+ */
+bool PostingList::load(const void *data, size_t size)
+{
+    *this = PostingList();
+    this->data.assign((const char *)data, size);
+    const unsigned char *bytes = (const unsigned char *)this->data.data();
+
+    size_t offset = 0;
+    uint32_t kind;
+    if (!readVarint(bytes, size, offset, kind) ||
+        !readVarint(bytes, size, offset, count))
+        return false;
+
+    if (kind == POSTINGS_BITSET)
+    {
+        isBitset = true;
+        bitsetOffset = offset;
+
+        return true;
+    }
+
+    uint32_t blockCount;
+    if (!readVarint(bytes, size, offset, blockCount))
+        return false;
+
+    uint32_t previousLast = 0;
+    for (uint32_t i = 0; i < blockCount; i++)
+    {
+        uint32_t firstDelta, lastDelta, pageCount, length;
+        if (!readVarint(bytes, size, offset, firstDelta) ||
+            !readVarint(bytes, size, offset, lastDelta) ||
+            !readVarint(bytes, size, offset, pageCount) ||
+            !readVarint(bytes, size, offset, length))
+            return false;
+
+        Block block;
+        block.first = previousLast + firstDelta;
+        block.last = block.first + lastDelta;
+        block.count = pageCount;
+        block.length = length;
+        blocks.push_back(block);
+
+        previousLast = block.last;
+    }
+
+    for (auto &block : blocks)
+    {
+        block.offset = offset;
+        offset += block.length;
+    }
+
+    return offset <= size;
+}
+
+/**
+ * @brief amount of pages in the list.
+ */
+uint32_t PostingList::size()
+{
+    return count;
+}
+
+void PostingList::decodeBlock(size_t index)
+{
+    const Block &block = blocks[index];
+    const unsigned char *bytes = (const unsigned char *)data.data();
+
+    pages.clear();
+    pages.push_back(block.first);
+
+    size_t offset = block.offset;
+    size_t end = block.offset + block.length;
+    uint32_t delta;
+    while (pages.size() < block.count && readVarint(bytes, end, offset, delta))
+        pages.push_back(pages.back() + delta);
+
+    decodedBlock = index;
+    pageIndex = 0;
+}
+
+/**
+ * @brief moves to the first page greater or equal than target. Never moves back.
+ * Blocks whose last page is below target are skipped without being decoded.
+ *
+ * @param target the page to look for
+ * @return the page reached, or POSTING_END if there are none left
+ */
+uint32_t PostingList::advance(uint32_t target)
+{
+    // Pages start at 1, current is 0 until the first advance.
+    if (current == POSTING_END || (current >= target && current != 0))
+        return current;
+
+    if (isBitset)
+    {
+        size_t bitsetSize = data.size() - bitsetOffset;
+        const unsigned char *bits = (const unsigned char *)data.data() + bitsetOffset;
+
+        for (size_t page = target; page / 8 < bitsetSize; page++)
+        {
+            // Skip empty bytes at once.
+            if (page % 8 == 0 && !bits[page / 8])
+            {
+                page += 7;
+                continue;
+            }
+
+            if (bits[page / 8] & (1 << (page % 8)))
+                return current = (uint32_t)page;
+        }
+
+        return current = POSTING_END;
+    }
+
+    // Binary search over the skip table for the first block that may hold target.
+    auto found = lower_bound(blocks.begin() + blockIndex,
+                             blocks.end(),
+                             target,
+                             [](const Block &block, uint32_t page)
+                             { return block.last < page; });
+    blockIndex = found - blocks.begin();
+
+    if (blockIndex == blocks.size())
+        return current = POSTING_END;
+
+    if (decodedBlock != blockIndex)
+        decodeBlock(blockIndex);
+
+    auto page = lower_bound(pages.begin() + pageIndex, pages.end(), target);
+    pageIndex = page - pages.begin();
+
+    // Only on a corrupt block, its pages should reach block.last.
+    if (page == pages.end())
+        return current = POSTING_END;
+
+    return current = *page;
+}
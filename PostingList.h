@@ -0,0 +1,59 @@
+/**
+ * @file PostingList.h
+ * @author Santino Nastasi
+ * @author Camila Castro
+ * @brief Reads the pages containing a term, skipping over whole blocks
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2022-2024 Marc S. Ressl
+ */
+
+#ifndef POSTINGLIST_H
+#define POSTINGLIST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define POSTING_END UINT32_MAX
+
+class PostingList
+{
+public:
+    PostingList();
+
+    bool load(const void *data, size_t size);
+
+    uint32_t size();
+    uint32_t advance(uint32_t target);
+
+private:
+    struct Block
+    {
+        uint32_t first;
+        uint32_t last;
+        uint32_t count;
+        size_t offset;
+        size_t length;
+    };
+
+    void decodeBlock(size_t index);
+
+    std::string data;
+    uint32_t count;
+    uint32_t current;
+
+    // POSTINGS_BITSET
+    bool isBitset;
+    size_t bitsetOffset;
+
+    // POSTINGS_BLOCKS
+    std::vector<Block> blocks;
+    size_t blockIndex;
+    size_t decodedBlock;
+    std::vector<uint32_t> pages;
+    size_t pageIndex;
+};
+
+#endif
@@ -0,0 +1,300 @@
+/**
+ * @file QueryLog.cpp
+ * @author Santino Nastasi
+ * @author Camila Castro
+ * @brief Binary log of the queries served by edahttpd
+ * @version 0.2
+ *
+ * Request threads push entries into a ring buffer without taking locks; a
+ * background thread drains it to disk. If the buffer is full the entry is
+ * dropped and counted, so logging never slows down a request.
+ *
+ * File layout: the 8 byte magic "EDAQLOG2", then one record per query with
+ * the QueryLogEntry fields in order, little endian, and the query bytes:
+ * queryLength of them, or QUERY_LOG_MAX_QUERY if the query was truncated.
+ * "EDAQLOG1" logs, without suggestMicros, are still read.
+ *
+ * @copyright Copyright (c) 2022-2024 Marc S. Ressl
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "QueryLog.h"
+
+using namespace std;
+
+#define QUERY_LOG_MAGIC "EDAQLOG2"
+#define QUERY_LOG_MAGIC_V1 "EDAQLOG1"
+#define QUERY_LOG_MAGIC_SIZE 8
+#define QUERY_LOG_DRAIN_INTERVAL_MS 10
+
+QueryLog::QueryLog(string path, size_t capacity)
+{
+    // The ring buffer needs a power of two capacity.
+    size_t size = 2;
+    while (size < capacity)
+        size *= 2;
+
+    slots.reset(new Slot[size]);
+    for (size_t i = 0; i < size; i++)
+        slots[i].sequence.store(i, memory_order_relaxed);
+
+    mask = size - 1;
+    pushPosition = 0;
+    popPosition = 0;
+    droppedCount = 0;
+
+    file = fopen(path.c_str(), "a+b");
+
+    // A new log starts with the magic, an existing one is appended to
+    // only if it has the same layout.
+    if (file)
+        fseek(file, 0, SEEK_END);
+    if (file && ftell(file) == 0)
+        fwrite(QUERY_LOG_MAGIC, 1, QUERY_LOG_MAGIC_SIZE, file);
+    else if (file)
+    {
+        char magic[QUERY_LOG_MAGIC_SIZE];
+        fseek(file, 0, SEEK_SET);
+        if (fread(magic, 1, QUERY_LOG_MAGIC_SIZE, file) != QUERY_LOG_MAGIC_SIZE ||
+            memcmp(magic, QUERY_LOG_MAGIC, QUERY_LOG_MAGIC_SIZE) != 0)
+        {
+            fclose(file);
+            file = NULL;
+        }
+        else
+            fseek(file, 0, SEEK_END);
+    }
+
+    running = (file != NULL);
+    if (running)
+        writer = thread(&QueryLog::run, this);
+}
+
+QueryLog::~QueryLog()
+{
+    running = false;
+    if (writer.joinable())
+        writer.join();
+
+    if (file)
+    {
+        drain();
+        fclose(file);
+    }
+}
+
+bool QueryLog::isOpen()
+{
+    return file != NULL;
+}
+
+/**
+ * @brief queues an entry to be written. Safe to call from any thread.
+ *
+ * @param entry the entry
+ * @return false if the buffer was full and the entry was dropped
+ */
+bool QueryLog::record(const QueryLogEntry &entry)
+{
+    if (!file)
+        return false;
+
+    size_t position = pushPosition.load(memory_order_relaxed);
+    Slot *slot;
+
+    while (true)
+    {
+        slot = &slots[position & mask];
+        size_t sequence = slot->sequence.load(memory_order_acquire);
+        intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+
+        if (difference == 0)
+        {
+            // Free slot, claim it.
+            if (pushPosition.compare_exchange_weak(position, position + 1, memory_order_relaxed))
+                break;
+        }
+        else if (difference < 0)
+        {
+            // The writer has not freed this slot yet: buffer full.
+            droppedCount++;
+
+            return false;
+        }
+        else
+            position = pushPosition.load(memory_order_relaxed);
+    }
+
+    slot->entry = entry;
+    slot->sequence.store(position + 1, memory_order_release);
+
+    return true;
+}
+
+/**
+ * @brief amount of entries dropped because the buffer was full.
+ */
+uint64_t QueryLog::getDroppedCount()
+{
+    return droppedCount;
+}
+
+bool QueryLog::pop(QueryLogEntry &entry)
+{
+    Slot *slot = &slots[popPosition & mask];
+
+    if (slot->sequence.load(memory_order_acquire) != popPosition + 1)
+        return false;
+
+    entry = slot->entry;
+    slot->sequence.store(popPosition + mask + 1, memory_order_release);
+    popPosition++;
+
+    return true;
+}
+
+static void writeLittleEndian(string &buffer, uint64_t value, int size)
+{
+    for (int i = 0; i < size; i++)
+        buffer += (char)((value >> (8 * i)) & 0xFF);
+}
+
+static uint64_t readLittleEndian(const unsigned char *bytes, int size)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < size; i++)
+        value |= (uint64_t)bytes[i] << (8 * i);
+
+    return value;
+}
+
+void QueryLog::drain()
+{
+    string buffer;
+    QueryLogEntry entry;
+
+    while (pop(entry))
+    {
+        writeLittleEndian(buffer, entry.timestamp, 8);
+        writeLittleEndian(buffer, entry.resultCount, 4);
+        writeLittleEndian(buffer, entry.parseMicros, 4);
+        writeLittleEndian(buffer, entry.openMicros, 4);
+        writeLittleEndian(buffer, entry.evaluateMicros, 4);
+        writeLittleEndian(buffer, entry.fetchMicros, 4);
+        writeLittleEndian(buffer, entry.suggestMicros, 4);
+        writeLittleEndian(buffer, entry.totalMicros, 4);
+        writeLittleEndian(buffer, entry.queryLength, 2);
+        buffer.append(entry.query, min((size_t)entry.queryLength, (size_t)QUERY_LOG_MAX_QUERY));
+    }
+
+    if (!buffer.empty())
+    {
+        fwrite(buffer.data(), 1, buffer.size(), file);
+        fflush(file);
+    }
+}
+
+void QueryLog::run()
+{
+    while (running)
+    {
+        drain();
+        this_thread::sleep_for(chrono::milliseconds(QUERY_LOG_DRAIN_INTERVAL_MS));
+    }
+}
+
+/**
+ * @brief sets the query of an entry. A long query is truncated, and its
+ * whole length is kept so the entry is known to be truncated.
+ *
+ * @param entry the entry
+ * @param query the normalized query
+ */
+void setQueryLogText(QueryLogEntry &entry, const string &query)
+{
+    memcpy(entry.query, query.data(), min(query.size(), (size_t)QUERY_LOG_MAX_QUERY));
+    entry.queryLength = (uint16_t)min(query.size(), (size_t)UINT16_MAX);
+}
+
+/**
+ * @brief the query of an entry, only its beginning if it was truncated.
+ */
+string getQueryLogText(const QueryLogEntry &entry)
+{
+    return string(entry.query, min((size_t)entry.queryLength, (size_t)QUERY_LOG_MAX_QUERY));
+}
+
+/**
+ * @brief checks if the query of an entry was too long to be kept whole.
+ * Replaying it runs a different query.
+ */
+bool isQueryLogTruncated(const QueryLogEntry &entry)
+{
+    return entry.queryLength > QUERY_LOG_MAX_QUERY;
+}
+
+/**
+ * @brief reads a log written by QueryLog.
+ *
+ * @param path the log file
+ * @param entries the entries read
+ * @return false if the file can't be opened or is not a query log
+ */
+bool readQueryLog(string path, vector<QueryLogEntry> &entries)
+{
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+
+    char magic[QUERY_LOG_MAGIC_SIZE];
+    if (fread(magic, 1, QUERY_LOG_MAGIC_SIZE, file) != QUERY_LOG_MAGIC_SIZE)
+    {
+        fclose(file);
+        return false;
+    }
+
+    bool hasSuggest = (memcmp(magic, QUERY_LOG_MAGIC, QUERY_LOG_MAGIC_SIZE) == 0);
+    if (!hasSuggest && memcmp(magic, QUERY_LOG_MAGIC_V1, QUERY_LOG_MAGIC_SIZE) != 0)
+    {
+        fclose(file);
+        return false;
+    }
+
+    const int headerSize = 8 + (hasSuggest ? 7 : 6) * 4 + 2;
+    unsigned char header[8 + 7 * 4 + 2];
+
+    // A record cut short by a crash ends the log.
+    while (fread(header, 1, headerSize, file) == (size_t)headerSize)
+    {
+        const unsigned char *field = header + 28;
+
+        QueryLogEntry entry;
+        entry.timestamp = readLittleEndian(header, 8);
+        entry.resultCount = (uint32_t)readLittleEndian(header + 8, 4);
+        entry.parseMicros = (uint32_t)readLittleEndian(header + 12, 4);
+        entry.openMicros = (uint32_t)readLittleEndian(header + 16, 4);
+        entry.evaluateMicros = (uint32_t)readLittleEndian(header + 20, 4);
+        entry.fetchMicros = (uint32_t)readLittleEndian(header + 24, 4);
+        entry.suggestMicros = 0;
+        if (hasSuggest)
+        {
+            entry.suggestMicros = (uint32_t)readLittleEndian(field, 4);
+            field += 4;
+        }
+        entry.totalMicros = (uint32_t)readLittleEndian(field, 4);
+        entry.queryLength = (uint16_t)readLittleEndian(field + 4, 2);
+
+        size_t storedLength = min((size_t)entry.queryLength, (size_t)QUERY_LOG_MAX_QUERY);
+        if (fread(entry.query, 1, storedLength, file) != storedLength)
+            break;
+
+        entries.push_back(entry);
+    }
+
+    fclose(file);
+
+    return true;
+}
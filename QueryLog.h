@@ -0,0 +1,84 @@
+/**
+ * @file QueryLog.h
+ * @author Santino Nastasi
+ * @author Camila Castro
+ * @brief Binary log of the queries served by edahttpd
+ * @version 0.2
+ *
+ * @copyright Copyright (c) 2022-2024 Marc S. Ressl
+ */
+
+#ifndef QUERYLOG_H
+#define QUERYLOG_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define QUERY_LOG_MAX_QUERY 240
+
+struct QueryLogEntry
+{
+    // Microseconds since the epoch
+    uint64_t timestamp;
+    uint32_t resultCount;
+
+    // Stage timings in microseconds, see SearchStats
+    uint32_t parseMicros;
+    uint32_t openMicros;
+    uint32_t evaluateMicros;
+    uint32_t fetchMicros;
+    uint32_t suggestMicros;
+    // Whole request, including building the response page
+    uint32_t totalMicros;
+
+    // Normalized query as typed, not its correction. queryLength is its whole
+    // length, but only the first QUERY_LOG_MAX_QUERY bytes are kept.
+    uint16_t queryLength;
+    char query[QUERY_LOG_MAX_QUERY];
+};
+
+class QueryLog
+{
+public:
+    QueryLog(std::string path, size_t capacity);
+    ~QueryLog();
+
+    bool isOpen();
+    bool record(const QueryLogEntry &entry);
+    uint64_t getDroppedCount();
+
+private:
+    struct Slot
+    {
+        std::atomic<size_t> sequence;
+        QueryLogEntry entry;
+    };
+
+    bool pop(QueryLogEntry &entry);
+    void drain();
+    void run();
+
+    FILE *file;
+
+    // Bounded lock-free ring buffer: many request threads push, the writer thread pops.
+    std::unique_ptr<Slot[]> slots;
+    size_t mask;
+    std::atomic<size_t> pushPosition;
+    size_t popPosition;
+    std::atomic<uint64_t> droppedCount;
+
+    std::atomic<bool> running;
+    std::thread writer;
+};
+
+void setQueryLogText(QueryLogEntry &entry, const std::string &query);
+std::string getQueryLogText(const QueryLogEntry &entry);
+bool isQueryLogTruncated(const QueryLogEntry &entry);
+bool readQueryLog(std::string path, std::vector<QueryLogEntry> &entries);
+
+#endif
@@ -0,0 +1,374 @@
+/**
+ * @file QueryParser.cpp
+ * @author Santino Nastasi
+ * @author Camila Castro
+ * @brief Parses EDAoogle search queries
+ * @version 0.3
+ *
+ * Grammar, from lowest to highest precedence:
+ *   a | b          OR
+ *   a & b, a b     AND
+ *   ~a             NOT
+ *   (a)            grouping
+ *   "a b c"        exact phrase
+ *   a NEAR/k b     a and b at most k terms apart (k defaults to 10)
+ *
+ * @copyright Copyright (c) 2022-2024 Marc S. Ressl
+ */
+
+#include <cctype>
+
+#include "QueryParser.h"
+#include "TextTokenizer.h"
+
+using namespace std;
+
+#define DEFAULT_NEAR_DISTANCE 10
+// Bounds the work a single query can ask for, extra terms are dropped.
+#define MAX_QUERY_TERMS 32
+// Bounds the recursion of the parser and evaluator, deeper ~ and ( are dropped.
+#define MAX_QUERY_NESTING 32
+
+enum QueryTokenType
+{
+    TOKEN_WORD,
+    TOKEN_PHRASE,
+    TOKEN_NEAR,
+    TOKEN_AND,
+    TOKEN_OR,
+    TOKEN_NOT,
+    TOKEN_OPEN,
+    TOKEN_CLOSE,
+};
+
+struct QueryToken
+{
+    QueryTokenType type;
+    vector<string> terms;
+    unsigned int distance;
+};
+
+struct QueryCursor
+{
+    vector<QueryToken> tokens;
+    size_t next = 0;
+    int depth = 0;
+    int nesting = 0;
+    size_t termCount = 0;
+
+    bool atEnd() { return next >= tokens.size(); }
+    QueryTokenType peek() { return tokens[next].type; }
+};
+
+static bool isOperator(char c)
+{
+    return c == '&' || c == '|' || c == '~' || c == '(' || c == ')' || c == '"';
+}
+
+/**
+ * @brief splits the query into operators, words and quoted phrases.
+ *
+ * @param query the query as typed by the user
+ * @return the tokens
+ */
+static vector<QueryToken> lexQuery(const string &query)
+{
+    vector<QueryToken> tokens;
+
+    size_t i = 0;
+    while (i < query.size())
+    {
+        char c = query[i];
+
+        if (isspace((unsigned char)c))
+        {
+            i++;
+        }
+        else if (c == '"')
+        {
+            size_t end = query.find('"', i + 1);
+            if (end == string::npos)
+                end = query.size();
+
+            tokens.push_back({TOKEN_PHRASE, tokenizeText(query.substr(i + 1, end - i - 1)), 0});
+            i = end + 1;
+        }
+        else if (isOperator(c))
+        {
+            QueryTokenType type = TOKEN_AND;
+            if (c == '|')
+                type = TOKEN_OR;
+            else if (c == '~')
+                type = TOKEN_NOT;
+            else if (c == '(')
+                type = TOKEN_OPEN;
+            else if (c == ')')
+                type = TOKEN_CLOSE;
+
+            tokens.push_back({type, {}, 0});
+            i++;
+        }
+        else
+        {
+            size_t end = i;
+            while (end < query.size() && !isspace((unsigned char)query[end]) && !isOperator(query[end]))
+                end++;
+
+            string word = query.substr(i, end - i);
+            i = end;
+
+            // NEAR and NEAR/k are operators only when written in uppercase.
+            if (word.compare(0, 4, "NEAR") == 0)
+            {
+                string suffix = word.substr(4);
+                if (suffix.empty())
+                {
+                    tokens.push_back({TOKEN_NEAR, {}, DEFAULT_NEAR_DISTANCE});
+                    continue;
+                }
+                if (suffix.size() > 1 && suffix.size() < 6 && suffix[0] == '/' &&
+                    suffix.find_first_not_of("0123456789", 1) == string::npos)
+                {
+                    tokens.push_back({TOKEN_NEAR, {}, (unsigned int)stoul(suffix.substr(1))});
+                    continue;
+                }
+            }
+
+            tokens.push_back({TOKEN_WORD, tokenizeText(word), 0});
+        }
+    }
+
+    return tokens;
+}
+
+static bool parseOr(QueryCursor &cursor, QueryNode &node);
+
+/**
+ * @brief makes a node out of the terms of a word or phrase. A word that
+ * splits into several terms (e.g. "copa-america") is treated as a phrase.
+ *
+ * @return false if there are no terms
+ */
+static bool makeTermsNode(QueryCursor &cursor, const vector<string> &terms, QueryNode &node)
+{
+    if (terms.empty() || cursor.termCount + terms.size() > MAX_QUERY_TERMS)
+        return false;
+
+    cursor.termCount += terms.size();
+
+    node.type = (terms.size() == 1) ? QUERY_TERM : QUERY_PHRASE;
+    node.terms = terms;
+
+    return true;
+}
+
+static bool parsePrimary(QueryCursor &cursor, QueryNode &node)
+{
+    QueryToken &token = cursor.tokens[cursor.next++];
+
+    if (token.type == TOKEN_OPEN)
+    {
+        if (cursor.nesting >= MAX_QUERY_NESTING)
+            return false;
+
+        cursor.depth++;
+        cursor.nesting++;
+        bool found = parseOr(cursor, node);
+        cursor.nesting--;
+        cursor.depth--;
+
+        if (!cursor.atEnd() && cursor.peek() == TOKEN_CLOSE)
+            cursor.next++;
+
+        return found;
+    }
+
+    if (!makeTermsNode(cursor, token.terms, node))
+        return false;
+
+    // Proximity chain: a NEAR/k b NEAR/k c
+    while (!cursor.atEnd() && cursor.peek() == TOKEN_NEAR)
+    {
+        unsigned int distance = cursor.tokens[cursor.next++].distance;
+
+        if (cursor.atEnd() ||
+            (cursor.peek() != TOKEN_WORD && cursor.peek() != TOKEN_PHRASE))
+            break;
+
+        // Phrases stay whole, "copa del" NEAR/5 mundo needs "copa del" together.
+        QueryNode operand;
+        if (!makeTermsNode(cursor, cursor.tokens[cursor.next++].terms, operand))
+            continue;
+
+        if (node.type != QUERY_NEAR)
+        {
+            QueryNode first = move(node);
+            node = QueryNode();
+            node.type = QUERY_NEAR;
+            node.distance = distance;
+            node.children.push_back(move(first));
+        }
+        else if (distance < node.distance)
+            node.distance = distance;
+
+        node.children.push_back(move(operand));
+    }
+
+    return true;
+}
+
+static bool parseUnary(QueryCursor &cursor, QueryNode &node)
+{
+    // ~~a is a, so a run of ~ is one NOT or none.
+    bool isNegated = false;
+    while (!cursor.atEnd() && cursor.peek() == TOKEN_NOT)
+    {
+        cursor.next++;
+        isNegated = !isNegated;
+    }
+
+    if (cursor.atEnd())
+        return false;
+
+    if (!isNegated)
+        return parsePrimary(cursor, node);
+
+    if (cursor.nesting >= MAX_QUERY_NESTING)
+        return false;
+
+    QueryNode child;
+    cursor.nesting++;
+    bool found = parsePrimary(cursor, child);
+    cursor.nesting--;
+
+    if (!found)
+        return false;
+
+    node.type = QUERY_NOT;
+    node.children.push_back(move(child));
+
+    return true;
+}
+
+static bool parseAnd(QueryCursor &cursor, QueryNode &node)
+{
+    node.type = QUERY_AND;
+
+    while (!cursor.atEnd())
+    {
+        QueryTokenType type = cursor.peek();
+
+        if (type == TOKEN_OR || (type == TOKEN_CLOSE && cursor.depth > 0))
+            break;
+
+        // Stray operators are ignored, AND is implicit between operands.
+        if (type == TOKEN_AND || type == TOKEN_CLOSE || type == TOKEN_NEAR)
+        {
+            cursor.next++;
+            continue;
+        }
+
+        QueryNode child;
+        if (parseUnary(cursor, child))
+            node.children.push_back(move(child));
+    }
+
+    if (node.children.empty())
+        return false;
+
+    if (node.children.size() == 1)
+    {
+        QueryNode child = move(node.children[0]);
+        node = move(child);
+    }
+
+    return true;
+}
+
+static bool parseOr(QueryCursor &cursor, QueryNode &node)
+{
+    node.type = QUERY_OR;
+
+    while (!cursor.atEnd())
+    {
+        if (cursor.peek() == TOKEN_OR)
+        {
+            cursor.next++;
+            continue;
+        }
+        if (cursor.peek() == TOKEN_CLOSE && cursor.depth > 0)
+            break;
+
+        QueryNode child;
+        if (parseAnd(cursor, child))
+            node.children.push_back(move(child));
+    }
+
+    if (node.children.empty())
+        return false;
+
+    if (node.children.size() == 1)
+    {
+        QueryNode child = move(node.children[0]);
+        node = move(child);
+    }
+
+    return true;
+}
+
+/**
+ * @brief parses a query typed by the user. Unknown symbols are dropped and
+ * stray operators are ignored, so any string parses to something sensible.
+ *
+ * @param query the query
+ * @param root the parsed query
+ * @return false if the query has no terms
+ */
+bool parseQuery(const string &query, QueryNode &root)
+{
+    QueryCursor cursor;
+    cursor.tokens = lexQuery(query);
+
+    root = QueryNode();
+
+    return parseOr(cursor, root);
+}
+
+/**
+ * @brief writes the query back in canonical form: normalized terms, explicit
+ * operators and parentheses. Parsing the result gives back the same query.
+ *
+ * @param node the query
+ * @return the normalized query
+ */
+string queryToString(const QueryNode &node)
+{
+    string text;
+
+    switch (node.type)
+    {
+    case QUERY_TERM:
+        return node.terms[0];
+
+    case QUERY_PHRASE:
+        for (auto &term : node.terms)
+            text += (text.empty() ? "" : " ") + term;
+        return "\"" + text + "\"";
+
+    case QUERY_NEAR:
+        for (auto &child : node.children)
+            text += (text.empty() ? "" : " NEAR/" + to_string(node.distance) + " ") + queryToString(child);
+        return text;
+
+    case QUERY_NOT:
+        return "~" + queryToString(node.children[0]);
+
+    case QUERY_AND:
+    case QUERY_OR:
+        for (auto &child : node.children)
+            text += (text.empty() ? "" : (node.type == QUERY_AND ? " & " : " | ")) + queryToString(child);
+        return "(" + text + ")";
+    }
+
+    return text;
+}
@@ -0,0 +1,43 @@
+/**
+ * @file QueryParser.h
+ * @author Santino Nastasi
+ * @author Camila Castro
+ * @brief Parses EDAoogle search queries
+ * @version 0.2
+ *
+ * @copyright Copyright (c) 2022-2024 Marc S. Ressl
+ */
+
+#ifndef QUERYPARSER_H
+#define QUERYPARSER_H
+
+#include <string>
+#include <vector>
+
+enum QueryNodeType
+{
+    QUERY_TERM,
+    QUERY_PHRASE,
+    QUERY_NEAR,
+    QUERY_AND,
+    QUERY_OR,
+    QUERY_NOT,
+};
+
+struct QueryNode
+{
+    QueryNodeType type;
+
+    // QUERY_TERM (one term) and QUERY_PHRASE
+    std::vector<std::string> terms;
+    // QUERY_NEAR: maximum distance between the first and last term
+    unsigned int distance = 0;
+
+    // QUERY_AND, QUERY_OR, QUERY_NOT (one child) and QUERY_NEAR (its terms and phrases)
+    std::vector<QueryNode> children;
+};
+
+bool parseQuery(const std::string &query, QueryNode &root);
+std::string queryToString(const QueryNode &node);
+
+#endif
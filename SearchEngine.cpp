@@ -0,0 +1,1017 @@
+/**
+ * @file SearchEngine.cpp
+ * @author Santino Nastasi
+ * @author Camila Castro
+ * @brief Evaluates EDAoogle queries against the index database
+ * @version 0.5
+ *
+ * The query tree is turned into a tree of page iterators over the postings
+ * in wiki_postings. Every iterator moves forward with advance(target), so
+ * AND and NOT can skip over whole blocks of a frequent term instead of
+ * reading it entirely. Phrases and NEAR are checked against the positional
+ * index only for the pages their terms have in common.
+ *
+ * A sharded index is searched on every shard at once, on a thread pool, and
+ * the results of the shards are merged by page name.
+ *
+ * @copyright Copyright (c) 2022-2024 Marc S. Ressl
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+
+#include <sqlite3.h>
+
+#include "PostingCodec.h"
+#include "PostingList.h"
+#include "QueryParser.h"
+#include "SearchEngine.h"
+#include "SpellingIndex.h"
+
+using namespace std;
+
+// A term found in the index is only corrected to one in this many times more pages
+#define SPELLING_DOMINANCE 10
+
+/**
+ * @brief positions of the query terms inside one candidate page, loaded on demand.
+ */
+struct PagePositions
+{
+    sqlite3_stmt *statement;
+    uint32_t page;
+    map<string, vector<uint32_t>> terms;
+};
+
+/**
+ * @brief database state shared while building the iterators of one query.
+ */
+struct SearchContext
+{
+    sqlite3_stmt *postingsStatement;
+    uint32_t lastPage;
+    PagePositions pagePositions;
+};
+
+/**
+ * @brief walks the pages matching part of a query, in increasing order.
+ */
+class PageIterator
+{
+public:
+    virtual ~PageIterator() {}
+
+    // Moves to the first matching page greater or equal than target, never back.
+    virtual uint32_t advance(uint32_t target) = 0;
+    // Estimated amount of matching pages.
+    virtual uint32_t cost() = 0;
+
+protected:
+    // Pages start at 1, current is 0 until the first advance.
+    bool isAt(uint32_t target) { return current == POSTING_END || (current >= target && current != 0); }
+
+    uint32_t current = 0;
+};
+
+class TermIterator : public PageIterator
+{
+public:
+    PostingList postings;
+
+    uint32_t advance(uint32_t target) { return current = postings.advance(target); }
+    uint32_t cost() { return postings.size(); }
+};
+
+class AllIterator : public PageIterator
+{
+public:
+    AllIterator(uint32_t lastPage) : lastPage(lastPage) {}
+
+    uint32_t advance(uint32_t target)
+    {
+        if (isAt(target))
+            return current;
+
+        return current = (target > lastPage) ? POSTING_END : target;
+    }
+    uint32_t cost() { return lastPage; }
+
+private:
+    uint32_t lastPage;
+};
+
+/**
+ * @brief pages in every included iterator and in none of the excluded ones.
+ */
+class AndIterator : public PageIterator
+{
+public:
+    AndIterator(vector<unique_ptr<PageIterator>> included,
+                vector<unique_ptr<PageIterator>> excluded)
+        : included(move(included)), excluded(move(excluded))
+    {
+        // The rarest iterator leads, the others only jump to its pages.
+        sort(this->included.begin(), this->included.end(),
+             [](const unique_ptr<PageIterator> &a, const unique_ptr<PageIterator> &b)
+             { return a->cost() < b->cost(); });
+    }
+
+    uint32_t advance(uint32_t target)
+    {
+        if (isAt(target))
+            return current;
+
+        uint32_t page = target;
+        while (true)
+        {
+            page = included[0]->advance(page);
+            if (page == POSTING_END)
+                return current = POSTING_END;
+
+            bool agreed = true;
+            for (size_t i = 1; i < included.size() && agreed; i++)
+            {
+                uint32_t other = included[i]->advance(page);
+                if (other != page)
+                {
+                    page = other;
+                    agreed = false;
+                }
+            }
+            if (!agreed)
+                continue;
+
+            bool isExcluded = false;
+            for (size_t i = 0; i < excluded.size() && !isExcluded; i++)
+                isExcluded = (excluded[i]->advance(page) == page);
+
+            if (!isExcluded)
+                return current = page;
+
+            page++;
+        }
+    }
+    uint32_t cost() { return included[0]->cost(); }
+
+private:
+    vector<unique_ptr<PageIterator>> included;
+    vector<unique_ptr<PageIterator>> excluded;
+};
+
+class OrIterator : public PageIterator
+{
+public:
+    OrIterator(vector<unique_ptr<PageIterator>> children) : children(move(children)) {}
+
+    uint32_t advance(uint32_t target)
+    {
+        if (isAt(target))
+            return current;
+
+        current = POSTING_END;
+        for (auto &child : children)
+            current = min(current, child->advance(target));
+
+        return current;
+    }
+    uint32_t cost()
+    {
+        uint64_t total = 0;
+        for (auto &child : children)
+            total += child->cost();
+
+        return (uint32_t)min(total, (uint64_t)UINT32_MAX);
+    }
+
+private:
+    vector<unique_ptr<PageIterator>> children;
+};
+
+/**
+ * @brief every page not in child. Only used when a NOT has nothing to be excluded from.
+ */
+class NotIterator : public PageIterator
+{
+public:
+    NotIterator(unique_ptr<PageIterator> child, uint32_t lastPage)
+        : child(move(child)), lastPage(lastPage) {}
+
+    uint32_t advance(uint32_t target)
+    {
+        if (isAt(target))
+            return current;
+
+        for (uint32_t page = target; page <= lastPage; page++)
+        {
+            if (child->advance(page) != page)
+                return current = page;
+        }
+
+        return current = POSTING_END;
+    }
+    uint32_t cost() { return lastPage; }
+
+private:
+    unique_ptr<PageIterator> child;
+    uint32_t lastPage;
+};
+
+static bool matchesPhrase(PagePositions &pagePositions, const vector<string> &terms);
+static bool matchesNear(PagePositions &pagePositions, const vector<QueryNode> &operands, unsigned int distance);
+
+/**
+ * @brief pages containing a phrase or NEAR. Walks the pages containing all its
+ * terms and only then checks their positions.
+ */
+class PositionsIterator : public PageIterator
+{
+public:
+    PositionsIterator(unique_ptr<PageIterator> terms, const QueryNode &node, PagePositions &pagePositions)
+        : terms(move(terms)), node(node), pagePositions(pagePositions) {}
+
+    uint32_t advance(uint32_t target)
+    {
+        if (isAt(target))
+            return current;
+
+        uint32_t page = terms->advance(target);
+        while (page != POSTING_END && !matches(page))
+            page = terms->advance(page + 1);
+
+        return current = page;
+    }
+    uint32_t cost() { return terms->cost(); }
+
+private:
+    bool matches(uint32_t page)
+    {
+        if (pagePositions.page != page)
+        {
+            pagePositions.page = page;
+            pagePositions.terms.clear();
+        }
+
+        if (node.type == QUERY_PHRASE)
+            return matchesPhrase(pagePositions, node.terms);
+        else
+            return matchesNear(pagePositions, node.children, node.distance);
+    }
+
+    unique_ptr<PageIterator> terms;
+    const QueryNode &node;
+    PagePositions &pagePositions;
+};
+
+SearchEngine::SearchEngine(vector<string> databaseFiles)
+{
+    this->databaseFiles = databaseFiles;
+
+    // One thread per shard, up to one per core.
+    size_t threadCount = min(databaseFiles.size(), (size_t)max(1U, thread::hardware_concurrency()));
+    if (databaseFiles.size() > 1)
+        threadPool = make_unique<ThreadPool>(threadCount);
+
+    preloadSpellingTerms();
+}
+
+/**
+ * @brief gets the positions of a term in the current candidate page.
+ */
+static const vector<uint32_t> &getPositions(PagePositions &pagePositions, const string &term)
+{
+    auto cached = pagePositions.terms.find(term);
+    if (cached != pagePositions.terms.end())
+        return cached->second;
+
+    vector<uint32_t> &positions = pagePositions.terms[term];
+
+    sqlite3_stmt *statement = pagePositions.statement;
+    sqlite3_reset(statement);
+    sqlite3_bind_text(statement, 1, term.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(statement, 2, pagePositions.page);
+
+    if (sqlite3_step(statement) == SQLITE_ROW)
+        positions = decodePositions(sqlite3_column_blob(statement, 0),
+                                    sqlite3_column_bytes(statement, 0));
+
+    return positions;
+}
+
+/**
+ * @brief positions where the terms appear one right after the other.
+ */
+static vector<uint32_t> getPhraseStarts(PagePositions &pagePositions, const vector<string> &terms)
+{
+    // Start positions where the phrase may begin, narrowed term by term.
+    vector<uint32_t> starts = getPositions(pagePositions, terms[0]);
+
+    for (size_t i = 1; i < terms.size() && !starts.empty(); i++)
+    {
+        const vector<uint32_t> &positions = getPositions(pagePositions, terms[i]);
+
+        vector<uint32_t> matched;
+        size_t j = 0;
+        for (uint32_t start : starts)
+        {
+            while (j < positions.size() && positions[j] < start + i)
+                j++;
+
+            if (j < positions.size() && positions[j] == start + i)
+                matched.push_back(start);
+        }
+
+        starts.swap(matched);
+    }
+
+    return starts;
+}
+
+/**
+ * @brief checks if the terms appear one right after the other.
+ */
+static bool matchesPhrase(PagePositions &pagePositions, const vector<string> &terms)
+{
+    return !getPhraseStarts(pagePositions, terms).empty();
+}
+
+/**
+ * @brief checks if all the operands, each a term or a phrase, appear at most
+ * distance terms apart: the last one to start begins at most distance terms
+ * after the first one to end. No two operands share a position.
+ */
+static bool matchesNear(PagePositions &pagePositions, const vector<QueryNode> &operands, unsigned int distance)
+{
+    // An occurrence is the start of the term or phrase and spans its length.
+    vector<vector<uint32_t>> lists;
+    vector<uint32_t> lengths;
+    for (auto &operand : operands)
+    {
+        lists.push_back(getPhraseStarts(pagePositions, operand.terms));
+        if (lists.back().empty())
+            return false;
+
+        lengths.push_back((uint32_t)operand.terms.size());
+    }
+
+    // Try every occurrence as the one that ends first. Each other operand
+    // takes its earliest occurrence that ends later, starts within distance
+    // and does not overlap the ones already taken.
+    vector<pair<uint32_t, uint32_t>> taken;
+    for (size_t i = 0; i < lists.size(); i++)
+    {
+        for (uint32_t start : lists[i])
+        {
+            uint32_t end = start + lengths[i] - 1;
+
+            taken.assign(1, make_pair(start, end));
+
+            for (size_t j = 0; j < lists.size(); j++)
+            {
+                if (j == i)
+                    continue;
+
+                uint32_t firstStart = (end + 1 >= lengths[j]) ? end + 1 - lengths[j] : 0;
+                auto occurrence = lower_bound(lists[j].begin(), lists[j].end(), firstStart);
+
+                size_t takenCount = taken.size();
+                for (; occurrence != lists[j].end() && *occurrence <= end + distance; occurrence++)
+                {
+                    uint32_t occurrenceEnd = *occurrence + lengths[j] - 1;
+
+                    bool overlaps = false;
+                    for (auto &span : taken)
+                    {
+                        if (*occurrence <= span.second && span.first <= occurrenceEnd)
+                            overlaps = true;
+                    }
+
+                    if (!overlaps)
+                    {
+                        taken.push_back(make_pair(*occurrence, occurrenceEnd));
+                        break;
+                    }
+                }
+
+                if (taken.size() == takenCount)
+                    break;
+            }
+
+            if (taken.size() == lists.size())
+                return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief loads the postings of a term. Unknown terms and corrupt lists get
+ * an empty list.
+ */
+static unique_ptr<PageIterator> makeTermIterator(SearchContext &context, const string &term)
+{
+    auto iterator = make_unique<TermIterator>();
+
+    sqlite3_stmt *statement = context.postingsStatement;
+    sqlite3_reset(statement);
+    sqlite3_bind_text(statement, 1, term.c_str(), -1, SQLITE_TRANSIENT);
+
+    // A corrupt list could point past its data, it reads as empty instead.
+    if (sqlite3_step(statement) == SQLITE_ROW &&
+        !iterator->postings.load(sqlite3_column_blob(statement, 0),
+                                 sqlite3_column_bytes(statement, 0)))
+        iterator->postings = PostingList();
+
+    return iterator;
+}
+
+/**
+ * @brief builds the iterator that walks the pages matching the query.
+ */
+static unique_ptr<PageIterator> makeIterator(SearchContext &context, const QueryNode &node)
+{
+    switch (node.type)
+    {
+    case QUERY_TERM:
+        return makeTermIterator(context, node.terms[0]);
+
+    case QUERY_PHRASE:
+    case QUERY_NEAR:
+    {
+        vector<unique_ptr<PageIterator>> terms;
+        for (auto &term : node.terms)
+            terms.push_back(makeTermIterator(context, term));
+        for (auto &operand : node.children)
+        {
+            for (auto &term : operand.terms)
+                terms.push_back(makeTermIterator(context, term));
+        }
+
+        auto allTerms = make_unique<AndIterator>(move(terms), vector<unique_ptr<PageIterator>>());
+
+        return make_unique<PositionsIterator>(move(allTerms), node, context.pagePositions);
+    }
+
+    case QUERY_AND:
+    {
+        vector<unique_ptr<PageIterator>> included;
+        vector<unique_ptr<PageIterator>> excluded;
+
+        for (auto &child : node.children)
+        {
+            if (child.type == QUERY_NOT)
+                excluded.push_back(makeIterator(context, child.children[0]));
+            else
+                included.push_back(makeIterator(context, child));
+        }
+
+        if (included.empty())
+            included.push_back(make_unique<AllIterator>(context.lastPage));
+
+        return make_unique<AndIterator>(move(included), move(excluded));
+    }
+
+    case QUERY_OR:
+    {
+        vector<unique_ptr<PageIterator>> children;
+        for (auto &child : node.children)
+            children.push_back(makeIterator(context, child));
+
+        return make_unique<OrIterator>(move(children));
+    }
+
+    case QUERY_NOT:
+    default:
+        return make_unique<NotIterator>(makeIterator(context, node.children[0]), context.lastPage);
+    }
+}
+
+/**
+ * @brief microseconds elapsed since start, restarting the count.
+ */
+static uint32_t lapMicros(chrono::steady_clock::time_point &start)
+{
+    auto now = chrono::steady_clock::now();
+    uint32_t micros = (uint32_t)chrono::duration_cast<chrono::microseconds>(now - start).count();
+    start = now;
+
+    return micros;
+}
+
+/**
+ * @brief searches the index.
+ *
+ * @param query the query as typed by the user
+ * @param results the names of the matching pages, sorted by name
+ * @param stats if not NULL, filled with the normalized query and stage timings
+ * @param maxResults keep only the first maxResults pages, 0 keeps them all
+ * @return false if the database could not be queried
+ */
+bool SearchEngine::search(const string &query, vector<string> &results, SearchStats *stats, size_t maxResults)
+{
+    SearchStats localStats;
+    if (!stats)
+        stats = &localStats;
+
+    auto start = chrono::steady_clock::now();
+
+    QueryNode root;
+    bool hasTerms = parseQuery(query, root);
+
+    stats->normalizedQuery = hasTerms ? queryToString(root) : "";
+    stats->parseMicros = lapMicros(start);
+
+    if (!hasTerms)
+        return true;
+
+    if (databaseFiles.size() == 1)
+        return searchShard(databaseFiles[0], root, maxResults, results, *stats);
+
+    // Scatter: every shard is searched on its own thread and connection.
+    vector<vector<string>> shardResults(databaseFiles.size());
+    vector<SearchStats> shardStats(databaseFiles.size());
+    vector<char> shardSucceeded(databaseFiles.size(), 0);
+    vector<future<void>> pending;
+
+    for (size_t i = 0; i < databaseFiles.size(); i++)
+    {
+        pending.push_back(threadPool->submit([&, i]()
+                                             { shardSucceeded[i] = searchShard(databaseFiles[i],
+                                                                               root,
+                                                                               maxResults,
+                                                                               shardResults[i],
+                                                                               shardStats[i]); }));
+    }
+
+    for (auto &shard : pending)
+        shard.wait();
+
+    // Gather: merge by page name, the shards ran in parallel so the slowest one sets each stage time.
+    bool success = true;
+    for (size_t i = 0; i < databaseFiles.size(); i++)
+    {
+        success = success && shardSucceeded[i];
+        results.insert(results.end(), shardResults[i].begin(), shardResults[i].end());
+
+        stats->openMicros = max(stats->openMicros, shardStats[i].openMicros);
+        stats->evaluateMicros = max(stats->evaluateMicros, shardStats[i].evaluateMicros);
+        stats->fetchMicros = max(stats->fetchMicros, shardStats[i].fetchMicros);
+        stats->isTruncated = stats->isTruncated || shardStats[i].isTruncated;
+    }
+
+    sort(results.begin(), results.end());
+    if (maxResults && results.size() > maxResults)
+    {
+        results.resize(maxResults);
+        stats->isTruncated = true;
+    }
+
+    return success;
+}
+
+/**
+ * @brief searches one index database.
+ *
+ * @param databaseFile the database
+ * @param root the parsed query
+ * @param maxResults stop after this many pages, 0 for all of them
+ * @param results the names of the matching pages, in page order
+ * @param stats filled with the stage timings
+ * @return false if the database could not be queried
+ */
+bool SearchEngine::searchShard(const string &databaseFile,
+                               const QueryNode &root,
+                               size_t maxResults,
+                               vector<string> &results,
+                               SearchStats &stats)
+{
+    auto start = chrono::steady_clock::now();
+
+    sqlite3 *database;
+
+    // Open database file
+    if (sqlite3_open_v2(databaseFile.c_str(), &database, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK)
+    {
+        cout << "Can't open database: " << sqlite3_errmsg(database) << endl;
+        sqlite3_close(database);
+
+        return false;
+    }
+
+    SearchContext context = {NULL, 0, {NULL, 0, {}}};
+    sqlite3_stmt *lastPageStatement = NULL;
+    sqlite3_stmt *pageStatement = NULL;
+
+    if (sqlite3_prepare_v2(database,
+                           "SELECT postings FROM wiki_postings WHERE term = ?;",
+                           -1,
+                           &context.postingsStatement,
+                           NULL) != SQLITE_OK ||
+        sqlite3_prepare_v2(database,
+                           "SELECT positions FROM wiki_positions WHERE term = ? AND page = ?;",
+                           -1,
+                           &context.pagePositions.statement,
+                           NULL) != SQLITE_OK ||
+        sqlite3_prepare_v2(database,
+                           "SELECT max(id) FROM wiki_pages;",
+                           -1,
+                           &lastPageStatement,
+                           NULL) != SQLITE_OK ||
+        sqlite3_prepare_v2(database,
+                           "SELECT page FROM wiki_pages WHERE id = ?;",
+                           -1,
+                           &pageStatement,
+                           NULL) != SQLITE_OK)
+    {
+        cout << "Error: " << sqlite3_errmsg(database) << endl;
+
+        sqlite3_finalize(context.postingsStatement);
+        sqlite3_finalize(context.pagePositions.statement);
+        sqlite3_finalize(lastPageStatement);
+        sqlite3_finalize(pageStatement);
+        sqlite3_close(database);
+
+        return false;
+    }
+
+    if (sqlite3_step(lastPageStatement) == SQLITE_ROW)
+        context.lastPage = (uint32_t)sqlite3_column_int64(lastPageStatement, 0);
+
+    stats.openMicros = lapMicros(start);
+
+    unique_ptr<PageIterator> iterator = makeIterator(context, root);
+
+    // Pages come in name order, so the first maxResults are the top ones.
+    vector<uint32_t> pages;
+    uint32_t page = iterator->advance(1);
+    for (; page != POSTING_END && (!maxResults || pages.size() < maxResults); page = iterator->advance(page + 1))
+        pages.push_back(page);
+
+    stats.isTruncated = (page != POSTING_END);
+
+    iterator.reset();
+
+    stats.evaluateMicros = lapMicros(start);
+
+    for (uint32_t page : pages)
+    {
+        sqlite3_reset(pageStatement);
+        sqlite3_bind_int64(pageStatement, 1, page);
+
+        if (sqlite3_step(pageStatement) == SQLITE_ROW)
+        {
+            const unsigned char *name = sqlite3_column_text(pageStatement, 0);
+            if (name)
+                results.push_back((const char *)name);
+        }
+    }
+
+    stats.fetchMicros = lapMicros(start);
+
+    sqlite3_finalize(context.postingsStatement);
+    sqlite3_finalize(context.pagePositions.statement);
+    sqlite3_finalize(lastPageStatement);
+    sqlite3_finalize(pageStatement);
+
+    // Close database
+    sqlite3_close(database);
+
+    return true;
+}
+
+/**
+ * @brief collects the distinct terms of a query.
+ */
+static void collectTerms(const QueryNode &node, set<string> &terms)
+{
+    terms.insert(node.terms.begin(), node.terms.end());
+
+    for (auto &child : node.children)
+        collectTerms(child, terms);
+}
+
+/**
+ * @brief replaces the terms of a query by their corrections.
+ */
+static void correctTerms(QueryNode &node, const map<string, string> &corrections)
+{
+    for (auto &term : node.terms)
+    {
+        auto correction = corrections.find(term);
+        if (correction != corrections.end())
+            term = correction->second;
+    }
+
+    for (auto &child : node.children)
+        correctTerms(child, corrections);
+}
+
+/**
+ * @brief reads wiki_spelling_terms.
+ *
+ * @param database the database
+ * @param spellingTerms filled with the terms and their page counts
+ * @return false if the table could not be read
+ */
+static bool loadSpellingTerms(sqlite3 *database, SpellingTerms &spellingTerms)
+{
+    sqlite3_stmt *statement;
+
+    if (sqlite3_prepare_v2(database,
+                           "SELECT id, term, pages FROM wiki_spelling_terms ORDER BY id;",
+                           -1,
+                           &statement,
+                           NULL) != SQLITE_OK)
+        return false;
+
+    while (sqlite3_step(statement) == SQLITE_ROW)
+    {
+        size_t id = (size_t)sqlite3_column_int64(statement, 0);
+        spellingTerms.terms.resize(id);
+        spellingTerms.pages.resize(id);
+
+        spellingTerms.terms[id - 1] = (const char *)sqlite3_column_text(statement, 1);
+        spellingTerms.pages[id - 1] = (uint32_t)sqlite3_column_int64(statement, 2);
+    }
+
+    sqlite3_finalize(statement);
+
+    return true;
+}
+
+/**
+ * @brief the spelling terms of a database, read again if the file changed
+ * since they were loaded: mkindex installs a new index by replacing it.
+ *
+ * @param shard the database, an index into databaseFiles
+ * @param database the database, open
+ * @param modifiedTime when the file was modified, read before opening it: if
+ * mkindex replaces it in between, the terms read are newer than the time and
+ * are reloaded once more, never kept as the terms of the newer file
+ * @return the terms, NULL if they could not be read
+ */
+shared_ptr<const SpellingTerms> SearchEngine::getSpellingTerms(size_t shard,
+                                                               sqlite3 *database,
+                                                               filesystem::file_time_type modifiedTime)
+{
+    // Only this database waits while its terms load.
+    lock_guard<mutex> lock(spellingTermsMutexes[shard]);
+
+    if (!spellingTerms[shard] || spellingTerms[shard]->modifiedTime != modifiedTime)
+    {
+        auto loaded = make_shared<SpellingTerms>();
+        loaded->modifiedTime = modifiedTime;
+        if (!loadSpellingTerms(database, *loaded))
+            return NULL;
+
+        spellingTerms[shard] = loaded;
+    }
+
+    return spellingTerms[shard];
+}
+
+/**
+ * @brief loads the spelling terms of every database, so the first
+ * suggestion does not pay for it. Databases without them are left for
+ * findSpellingCandidates to report.
+ */
+void SearchEngine::preloadSpellingTerms()
+{
+    spellingTerms.resize(databaseFiles.size());
+    spellingTermsMutexes = make_unique<mutex[]>(databaseFiles.size());
+
+    auto preload = [this](size_t shard)
+    {
+        error_code timeError;
+        auto modifiedTime = filesystem::last_write_time(databaseFiles[shard], timeError);
+
+        sqlite3 *database;
+        if (sqlite3_open_v2(databaseFiles[shard].c_str(), &database, SQLITE_OPEN_READONLY, NULL) == SQLITE_OK)
+            getSpellingTerms(shard, database, modifiedTime);
+        sqlite3_close(database);
+    };
+
+    if (!threadPool)
+    {
+        preload(0);
+        return;
+    }
+
+    vector<future<void>> pending;
+    for (size_t i = 0; i < databaseFiles.size(); i++)
+        pending.push_back(threadPool->submit([&, i]()
+                                             { preload(i); }));
+
+    for (auto &shard : pending)
+        shard.wait();
+}
+
+/**
+ * @brief finds the terms of one database a few edits away from each query
+ * term. Every deletion variant of the term is a primary key lookup in
+ * wiki_spelling, so the vocabulary is never scanned.
+ *
+ * @param shard the database, an index into databaseFiles
+ * @param terms the query terms
+ * @param candidates for each query term, the pages of every candidate, added up across shards
+ * @return false if the database could not be queried
+ */
+bool SearchEngine::findSpellingCandidates(size_t shard,
+                                          const set<string> &terms,
+                                          map<string, map<string, uint64_t>> &candidates)
+{
+    const string &databaseFile = databaseFiles[shard];
+
+    // Before opening it, see getSpellingTerms.
+    error_code timeError;
+    auto modifiedTime = filesystem::last_write_time(databaseFile, timeError);
+
+    sqlite3 *database;
+
+    if (sqlite3_open_v2(databaseFile.c_str(), &database, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK)
+    {
+        cout << "Can't open database: " << sqlite3_errmsg(database) << endl;
+        sqlite3_close(database);
+
+        return false;
+    }
+
+    shared_ptr<const SpellingTerms> shardTerms = getSpellingTerms(shard, database, modifiedTime);
+    if (!shardTerms)
+    {
+        cout << "Error: " << sqlite3_errmsg(database) << endl;
+        sqlite3_close(database);
+
+        return false;
+    }
+
+    sqlite3_stmt *variantStatement;
+
+    if (sqlite3_prepare_v2(database,
+                           "SELECT terms FROM wiki_spelling WHERE variant = ?;",
+                           -1,
+                           &variantStatement,
+                           NULL) != SQLITE_OK)
+    {
+        cout << "Error: " << sqlite3_errmsg(database) << endl;
+        sqlite3_close(database);
+
+        return false;
+    }
+
+    for (auto &term : terms)
+    {
+        unsigned int maxDistance = getMaxSpellingDistance(term);
+        if (!maxDistance)
+            continue;
+
+        set<uint32_t> ids;
+        for (auto &variant : getSpellingVariants(term, maxDistance))
+        {
+            sqlite3_reset(variantStatement);
+            sqlite3_bind_text(variantStatement, 1, variant.c_str(), -1, SQLITE_TRANSIENT);
+
+            if (sqlite3_step(variantStatement) == SQLITE_ROW)
+            {
+                vector<uint32_t> variantIds = decodePositions(sqlite3_column_blob(variantStatement, 0),
+                                                              sqlite3_column_bytes(variantStatement, 0));
+                ids.insert(variantIds.begin(), variantIds.end());
+            }
+        }
+
+        for (uint32_t id : ids)
+        {
+            if (id == 0 || id > shardTerms->terms.size())
+                continue;
+
+            const string &candidate = shardTerms->terms[id - 1];
+            if (candidate == term || getSpellingDistance(term, candidate, maxDistance) <= maxDistance)
+                candidates[term][candidate] += shardTerms->pages[id - 1];
+        }
+    }
+
+    sqlite3_finalize(variantStatement);
+    sqlite3_close(database);
+
+    return true;
+}
+
+/**
+ * @brief picks the correction of a term: the closest candidate, and among
+ * those the one in more pages.
+ *
+ * @param term the query term
+ * @param candidates the pages of the terms a few edits away
+ * @return the correction, or the same term if there is none
+ */
+static string pickCorrection(const string &term, const map<string, uint64_t> &candidates)
+{
+    unsigned int maxDistance = getMaxSpellingDistance(term);
+
+    auto known = candidates.find(term);
+    uint64_t termPages = (known != candidates.end()) ? known->second : 0;
+
+    string correction = term;
+    unsigned int bestDistance = maxDistance + 1;
+    uint64_t bestPages = 0;
+
+    for (auto &candidate : candidates)
+    {
+        if (candidate.first == term)
+            continue;
+
+        unsigned int distance = getSpellingDistance(term, candidate.first, maxDistance);
+
+        // A term found in the index is only replaced by a term one edit away.
+        if (termPages && (distance > 1 || candidate.second < termPages * SPELLING_DOMINANCE))
+            continue;
+        if (distance < bestDistance || (distance == bestDistance && candidate.second > bestPages))
+        {
+            correction = candidate.first;
+            bestDistance = distance;
+            bestPages = candidate.second;
+        }
+    }
+
+    return correction;
+}
+
+/**
+ * @brief suggests a spelling correction of a query.
+ *
+ * @param query the query as typed by the user
+ * @param suggestion the corrected query, with its operators kept
+ * @return true if some term of the query was corrected
+ */
+bool SearchEngine::suggest(const string &query, string &suggestion)
+{
+    QueryNode root;
+    if (!parseQuery(query, root))
+        return false;
+
+    set<string> terms;
+    collectTerms(root, terms);
+
+    map<string, map<string, uint64_t>> candidates;
+    if (databaseFiles.size() == 1)
+    {
+        if (!findSpellingCandidates(0, terms, candidates))
+            return false;
+    }
+    else
+    {
+        // Like search, every shard on its own thread, then the pages are added up.
+        vector<map<string, map<string, uint64_t>>> shardCandidates(databaseFiles.size());
+        vector<char> shardSucceeded(databaseFiles.size(), 0);
+        vector<future<void>> pending;
+
+        for (size_t i = 0; i < databaseFiles.size(); i++)
+        {
+            pending.push_back(threadPool->submit([&, i]()
+                                                 { shardSucceeded[i] = findSpellingCandidates(i,
+                                                                                              terms,
+                                                                                              shardCandidates[i]); }));
+        }
+
+        for (auto &shard : pending)
+            shard.wait();
+
+        for (size_t i = 0; i < databaseFiles.size(); i++)
+        {
+            if (!shardSucceeded[i])
+                return false;
+
+            for (auto &termCandidates : shardCandidates[i])
+            {
+                for (auto &candidate : termCandidates.second)
+                    candidates[termCandidates.first][candidate.first] += candidate.second;
+            }
+        }
+    }
+
+    map<string, string> corrections;
+    for (auto &entry : candidates)
+    {
+        string correction = pickCorrection(entry.first, entry.second);
+        if (correction != entry.first)
+            corrections[entry.first] = correction;
+    }
+
+    if (corrections.empty())
+        return false;
+
+    correctTerms(root, corrections);
+    suggestion = queryToString(root);
+
+    // Shown to the user, so without the parentheses around the whole query.
+    if ((root.type == QUERY_AND || root.type == QUERY_OR) && suggestion.size() >= 2)
+        suggestion = suggestion.substr(1, suggestion.size() - 2);
+
+    return true;
+}
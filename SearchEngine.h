@@ -0,0 +1,98 @@
+/**
+ * @file SearchEngine.h
+ * @author Santino Nastasi
+ * @author Camila Castro
+ * @brief Evaluates EDAoogle queries against the index database
+ * @version 0.4
+ *
+ * @copyright Copyright (c) 2022-2024 Marc S. Ressl
+ */
+
+#ifndef SEARCHENGINE_H
+#define SEARCHENGINE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <sqlite3.h>
+
+#include "QueryParser.h"
+#include "ThreadPool.h"
+
+// Searches with fewer results get a spelling suggestion
+#define SUGGESTION_MAX_RESULTS 5
+
+/**
+ * @brief what a search did and how long each stage took, in microseconds.
+ */
+struct SearchStats
+{
+    std::string normalizedQuery;
+
+    uint32_t parseMicros = 0;
+    uint32_t openMicros = 0;
+    uint32_t evaluateMicros = 0;
+    uint32_t fetchMicros = 0;
+    // Looking for a spelling suggestion, set by the caller of suggest
+    uint32_t suggestMicros = 0;
+
+    // The search stopped at maxResults with more pages matching
+    bool isTruncated = false;
+};
+
+/**
+ * @brief wiki_spelling_terms of one database, kept in memory so spelling
+ * candidates are resolved without a query per term.
+ */
+struct SpellingTerms
+{
+    // The database file the terms were read from, reloaded when it changes
+    std::filesystem::file_time_type modifiedTime;
+
+    // Indexed by term id - 1
+    std::vector<std::string> terms;
+    std::vector<uint32_t> pages;
+};
+
+class SearchEngine
+{
+public:
+    SearchEngine(std::vector<std::string> databaseFiles);
+
+    bool search(const std::string &query,
+                std::vector<std::string> &results,
+                SearchStats *stats = NULL,
+                size_t maxResults = 0);
+    bool suggest(const std::string &query, std::string &suggestion);
+
+private:
+    bool searchShard(const std::string &databaseFile,
+                     const QueryNode &root,
+                     size_t maxResults,
+                     std::vector<std::string> &results,
+                     SearchStats &stats);
+
+    bool findSpellingCandidates(size_t shard,
+                                const std::set<std::string> &terms,
+                                std::map<std::string, std::map<std::string, uint64_t>> &candidates);
+    std::shared_ptr<const SpellingTerms> getSpellingTerms(size_t shard,
+                                                          sqlite3 *database,
+                                                          std::filesystem::file_time_type modifiedTime);
+    void preloadSpellingTerms();
+
+    std::vector<std::string> databaseFiles;
+    std::unique_ptr<ThreadPool> threadPool;
+
+    // Per database, loaded when the engine starts and again when the file
+    // changes. Each database has its own lock so they load in parallel.
+    std::vector<std::shared_ptr<const SpellingTerms>> spellingTerms;
+    std::unique_ptr<std::mutex[]> spellingTermsMutexes;
+};
+
+#endif
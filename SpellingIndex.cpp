@@ -0,0 +1,194 @@
+/**
+ * @file SpellingIndex.cpp
+ * @author Santino Nastasi
+ * @author Camila Castro
+ * @brief Deletion variants and edit distance for spelling correction
+ * @version 0.1
+ *
+ * Symmetric delete spelling correction: two terms within k edits share a
+ * variant made by deleting at most k characters from each of them. mkindex
+ * stores the variants of every term in wiki_spelling, so the candidates for
+ * a misspelled term are found with a few primary key lookups and only those
+ * are checked with the real edit distance.
+ *
+ * @copyright Copyright (c) 2022-2024 Marc S. Ressl
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <set>
+
+#include "SpellingIndex.h"
+
+using namespace std;
+
+/**
+ * @brief splits a UTF-8 term into its characters.
+ */
+static vector<string> splitCharacters(const string &term)
+{
+    vector<string> characters;
+
+    size_t i = 0;
+    while (i < term.size())
+    {
+        unsigned char c = term[i];
+
+        size_t length = 1;
+        if ((c & 0xE0) == 0xC0)
+            length = 2;
+        else if ((c & 0xF0) == 0xE0)
+            length = 3;
+        else if ((c & 0xF8) == 0xF0)
+            length = 4;
+
+        characters.push_back(term.substr(i, length));
+        i += length;
+    }
+
+    return characters;
+}
+
+/**
+ * @brief splits a UTF-8 term into its characters, each one packed in an integer.
+ */
+static vector<uint32_t> packCharacters(const string &term)
+{
+    vector<uint32_t> characters;
+    characters.reserve(term.size());
+
+    for (unsigned char c : term)
+    {
+        // Continuation bytes go into the character they continue.
+        if ((c & 0xC0) == 0x80 && !characters.empty())
+            characters.back() = (characters.back() << 8) | c;
+        else
+            characters.push_back(c);
+    }
+
+    return characters;
+}
+
+/**
+ * @brief checks if a term takes part in spelling correction. Numbers and
+ * short terms are left alone, almost anything is a couple of edits away.
+ *
+ * @param term the term, as tokenized
+ * @return true if it is indexed and corrected
+ */
+bool isSpellingTerm(const string &term)
+{
+    for (char c : term)
+    {
+        if (c >= '0' && c <= '9')
+            return false;
+    }
+
+    return packCharacters(term).size() >= SPELLING_MIN_LENGTH;
+}
+
+/**
+ * @brief most edits allowed when correcting a term, fewer for short terms.
+ *
+ * @param term the term
+ * @return the distance, 0 if the term is not corrected
+ */
+unsigned int getMaxSpellingDistance(const string &term)
+{
+    if (!isSpellingTerm(term))
+        return 0;
+
+    return (packCharacters(term).size() < 6) ? 1 : SPELLING_MAX_DISTANCE;
+}
+
+static void addVariants(const vector<string> &characters, unsigned int distance, set<string> &variants)
+{
+    string variant;
+    for (auto &character : characters)
+        variant += character;
+
+    // Every delete shortens the variant, so one already seen was reached
+    // with the same distance left and its own variants are there too.
+    if (!variants.insert(variant).second)
+        return;
+
+    if (!distance || characters.size() <= SPELLING_MIN_LENGTH - SPELLING_MAX_DISTANCE)
+        return;
+
+    for (size_t i = 0; i < characters.size(); i++)
+    {
+        vector<string> shorter = characters;
+        shorter.erase(shorter.begin() + i);
+
+        addVariants(shorter, distance - 1, variants);
+    }
+}
+
+/**
+ * @brief variants of a term made by deleting up to maxDistance characters
+ * of its prefix, the prefix itself included.
+ *
+ * @param term the term
+ * @param maxDistance most characters deleted
+ * @return the variants, without repetitions
+ */
+vector<string> getSpellingVariants(const string &term, unsigned int maxDistance)
+{
+    vector<string> characters = splitCharacters(term);
+    if (characters.size() > SPELLING_PREFIX_LENGTH)
+        characters.resize(SPELLING_PREFIX_LENGTH);
+
+    set<string> variants;
+    addVariants(characters, maxDistance, variants);
+
+    return vector<string>(variants.begin(), variants.end());
+}
+
+/**
+ * @brief edit distance between two terms, counting insertions, deletions,
+ * substitutions and swaps of adjacent characters.
+ *
+ * @param a a term
+ * @param b another term
+ * @param maxDistance distances over this are not computed exactly
+ * @return the distance, or maxDistance + 1 if it is greater than maxDistance
+ */
+unsigned int getSpellingDistance(const string &a, const string &b, unsigned int maxDistance)
+{
+    vector<uint32_t> s = packCharacters(a);
+    vector<uint32_t> t = packCharacters(b);
+
+    size_t lengthDifference = (s.size() > t.size()) ? s.size() - t.size() : t.size() - s.size();
+    if (lengthDifference > maxDistance)
+        return maxDistance + 1;
+
+    // Three rows of the dynamic programming table: two rows back are needed for swaps.
+    vector<unsigned int> previous2(t.size() + 1), previous(t.size() + 1), current(t.size() + 1);
+    for (size_t j = 0; j <= t.size(); j++)
+        previous[j] = (unsigned int)j;
+
+    for (size_t i = 1; i <= s.size(); i++)
+    {
+        current[0] = (unsigned int)i;
+        unsigned int rowMinimum = current[0];
+
+        for (size_t j = 1; j <= t.size(); j++)
+        {
+            unsigned int cost = (s[i - 1] == t[j - 1]) ? 0 : 1;
+            current[j] = min({previous[j] + 1, current[j - 1] + 1, previous[j - 1] + cost});
+
+            if (i > 1 && j > 1 && s[i - 1] == t[j - 2] && s[i - 2] == t[j - 1])
+                current[j] = min(current[j], previous2[j - 2] + 1);
+
+            rowMinimum = min(rowMinimum, current[j]);
+        }
+
+        if (rowMinimum > maxDistance)
+            return maxDistance + 1;
+
+        swap(previous2, previous);
+        swap(previous, current);
+    }
+
+    return min(previous[t.size()], maxDistance + 1);
+}
@@ -0,0 +1,29 @@
+/**
+ * @file SpellingIndex.h
+ * @author Santino Nastasi
+ * @author Camila Castro
+ * @brief Deletion variants and edit distance for spelling correction
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2022-2024 Marc S. Ressl
+ */
+
+#ifndef SPELLINGINDEX_H
+#define SPELLINGINDEX_H
+
+#include <string>
+#include <vector>
+
+// Most edits between a misspelled term and its correction
+#define SPELLING_MAX_DISTANCE 2
+// Only the first characters of a term make variants, the rest is checked by distance
+#define SPELLING_PREFIX_LENGTH 7
+// Shortest term that is indexed or corrected, in characters
+#define SPELLING_MIN_LENGTH 4
+
+bool isSpellingTerm(const std::string &term);
+unsigned int getMaxSpellingDistance(const std::string &term);
+std::vector<std::string> getSpellingVariants(const std::string &term, unsigned int maxDistance);
+unsigned int getSpellingDistance(const std::string &a, const std::string &b, unsigned int maxDistance);
+
+#endif
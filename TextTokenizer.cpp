@@ -0,0 +1,130 @@
+/**
+ * @file TextTokenizer.cpp
+ * @author Santino Nastasi
+ * @author Camila Castro
+ * @brief Splits text into normalized index terms
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2022-2024 Marc S. Ressl
+ */
+
+#include "TextTokenizer.h"
+
+using namespace std;
+
+/**
+ * @brief folds an accented latin letter (second byte of a 0xC3 UTF-8 sequence)
+ * to its plain lowercase ASCII letter, the same way FTS5 removes diacritics.
+ *
+ * @param c second byte of the UTF-8 sequence
+ * @return the folded letter, or 0 if it has no plain equivalent
+ */
+static char foldLatinLetter(unsigned char c)
+{
+    // Uppercase and lowercase share the same layout, 0x20 apart.
+    if (c >= 0xA0)
+        c -= 0x20;
+
+    if (c >= 0x80 && c <= 0x85)
+        return 'a';
+    if (c == 0x87)
+        return 'c';
+    if (c >= 0x88 && c <= 0x8B)
+        return 'e';
+    if (c >= 0x8C && c <= 0x8F)
+        return 'i';
+    if (c == 0x91)
+        return 'n';
+    if ((c >= 0x92 && c <= 0x96) || c == 0x98)
+        return 'o';
+    if (c >= 0x99 && c <= 0x9C)
+        return 'u';
+    if (c == 0x9D)
+        return 'y';
+
+    return 0;
+}
+
+/**
+ * @brief splits text into terms. A term is a run of ASCII letters and digits
+ * or non-ASCII UTF-8 characters. Terms are lowercased and accents are removed,
+ * so "Selección" and "seleccion" are the same term.
+ *
+ * @param text the text to split
+ * @return the terms, in order of appearance
+ */
+vector<string> tokenizeText(const string &text)
+{
+    vector<string> terms;
+    string term;
+
+    size_t i = 0;
+    while (i < text.size())
+    {
+        unsigned char c = text[i];
+
+        if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z'))
+        {
+            term += c;
+            i++;
+        }
+        else if (c >= 'A' && c <= 'Z')
+        {
+            term += (char)(c - 'A' + 'a');
+            i++;
+        }
+        else if (c >= 0x80)
+        {
+            // Multibyte UTF-8 character, its length comes from the leading byte.
+            size_t length = 1;
+            if ((c & 0xE0) == 0xC0)
+                length = 2;
+            else if ((c & 0xF0) == 0xE0)
+                length = 3;
+            else if ((c & 0xF8) == 0xF0)
+                length = 4;
+
+            if (i + length > text.size())
+                length = text.size() - i;
+
+            // Latin-1 symbols (non-breaking space, « », °) and general
+            // punctuation (dashes, quotes, zero width space) separate terms.
+            unsigned char next = (length > 1) ? text[i + 1] : 0;
+            if (c == 0xC2 || (c == 0xE2 && (next == 0x80 || next == 0x81)))
+            {
+                if (!term.empty())
+                {
+                    terms.push_back(term);
+                    term.clear();
+                }
+                i += length;
+                continue;
+            }
+
+            char folded = 0;
+            if (c == 0xC3 && length == 2)
+                folded = foldLatinLetter(next);
+
+            if (folded)
+                term += folded;
+            else
+                term.append(text, i, length);
+
+            i += length;
+        }
+        else
+        {
+            if (!term.empty())
+            {
+                terms.push_back(term);
+                term.clear();
+            }
+            i++;
+        }
+    }
+
+    if (!term.empty())
+        terms.push_back(term);
+
+    return terms;
+}
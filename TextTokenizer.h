@@ -0,0 +1,19 @@
+/**
+ * @file TextTokenizer.h
+ * @author Santino Nastasi
+ * @author Camila Castro
+ * @brief Splits text into normalized index terms
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2022-2024 Marc S. Ressl
+ */
+
+#ifndef TEXTTOKENIZER_H
+#define TEXTTOKENIZER_H
+
+#include <string>
+#include <vector>
+
+std::vector<std::string> tokenizeText(const std::string &text);
+
+#endif
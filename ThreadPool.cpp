@@ -0,0 +1,75 @@
+/**
+ * @file ThreadPool.cpp
+ * @author Santino Nastasi
+ * @author Camila Castro
+ * @brief Fixed set of worker threads running queued tasks
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2022-2024 Marc S. Ressl
+ */
+
+#include "ThreadPool.h"
+
+using namespace std;
+
+ThreadPool::ThreadPool(size_t threadCount)
+{
+    stopping = false;
+
+    for (size_t i = 0; i < threadCount; i++)
+        workers.emplace_back(&ThreadPool::run, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> lock(tasksMutex);
+        stopping = true;
+    }
+    tasksAvailable.notify_all();
+
+    for (auto &worker : workers)
+        worker.join();
+}
+
+/**
+ * @brief queues a task to be run by the next free worker.
+ *
+ * @param task the task
+ * @return a future that becomes ready when the task has run
+ */
+future<void> ThreadPool::submit(function<void()> task)
+{
+    packaged_task<void()> packagedTask(move(task));
+    future<void> result = packagedTask.get_future();
+
+    {
+        lock_guard<mutex> lock(tasksMutex);
+        tasks.push(move(packagedTask));
+    }
+    tasksAvailable.notify_one();
+
+    return result;
+}
+
+void ThreadPool::run()
+{
+    while (true)
+    {
+        packaged_task<void()> task;
+
+        {
+            unique_lock<mutex> lock(tasksMutex);
+            tasksAvailable.wait(lock, [this]
+                                { return stopping || !tasks.empty(); });
+
+            if (tasks.empty())
+                return;
+
+            task = move(tasks.front());
+            tasks.pop();
+        }
+
+        task();
+    }
+}
@@ -0,0 +1,40 @@
+/**
+ * @file ThreadPool.h
+ * @author Santino Nastasi
+ * @author Camila Castro
+ * @brief Fixed set of worker threads running queued tasks
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2022-2024 Marc S. Ressl
+ */
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+    ThreadPool(size_t threadCount);
+    ~ThreadPool();
+
+    std::future<void> submit(std::function<void()> task);
+
+private:
+    void run();
+
+    std::vector<std::thread> workers;
+    std::queue<std::packaged_task<void()>> tasks;
+    std::mutex tasksMutex;
+    std::condition_variable tasksAvailable;
+    bool stopping;
+};
+
+#endif
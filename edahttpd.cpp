@@ -7,19 +7,24 @@
  * @copyright Copyright (c) 2022-2024 Marc S. Ressl
  */
 
+#include <algorithm>
 #include <iostream>
+#include <memory>
 
 #include <microhttpd.h>
 
 #include "CommandLineParser.h"
 #include "HttpServer.h"
 #include "HttpRequestHandler.h"
+#include "QueryLog.h"
 
 using namespace std;
 
+#define QUERY_LOG_CAPACITY 4096
+
 void printHelp()
 {
-    cout << "Usage: edahttpd -h WWW_PATH [-p PORT] " << endl;
+    cout << "Usage: edahttpd -h WWW_PATH [-p PORT] [-l QUERY_LOG] [-n SHARDS] [-k MAX_RESULTS] " << endl;
 };
 
 int main(int argc, const char *argv[])
@@ -28,6 +33,8 @@ int main(int argc, const char *argv[])
 
     // Configuration
     int port = 8000;
+    int shardCount = 1;
+    size_t maxResults = 0;
     string wwwPath;
 
     // Parse command line
@@ -45,10 +52,34 @@ int main(int argc, const char *argv[])
     if (parser.hasOption("-p"))
         port = stoi(parser.getOption("-p"));
 
+    // Index built with mkindex -n SHARDS
+    if (parser.hasOption("-n"))
+        shardCount = max(1, stoi(parser.getOption("-n")));
+
+    if (parser.hasOption("-k"))
+        maxResults = stoul(parser.getOption("-k"));
+
+    // Optional binary log of the served queries, replayable with edareplay.
+    // Created before the server so it outlives the request threads.
+    unique_ptr<QueryLog> queryLog;
+    if (parser.hasOption("-l"))
+    {
+        queryLog = make_unique<QueryLog>(parser.getOption("-l"), QUERY_LOG_CAPACITY);
+        if (!queryLog->isOpen())
+        {
+            cout << "error: can't open query log." << endl;
+
+            return 1;
+        }
+    }
+
     // Start server
     HttpServer server(port);
 
-    HttpRequestHandler edaOogleHttpRequestHandler(wwwPath);
+    HttpRequestHandler edaOogleHttpRequestHandler(wwwPath, shardCount);
+
+    edaOogleHttpRequestHandler.setQueryLog(queryLog.get());
+    edaOogleHttpRequestHandler.setMaxResults(maxResults);
     server.setHttpRequestHandler(&edaOogleHttpRequestHandler);
 
     if (server.isRunning())
@@ -0,0 +1,367 @@
+/**
+ * @file edareplay.cpp
+ * @author Santino Nastasi
+ * @author Camila Castro
+ * @brief Replays an edahttpd query log and compares latencies between builds
+ * @version 0.1
+ *
+ * @copyright Copyright (c) 2022-2024 Marc S. Ressl
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET SocketHandle;
+#define closeSocket closesocket
+#else
+#include <netdb.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int SocketHandle;
+#define INVALID_SOCKET -1
+#define closeSocket close
+#endif
+
+#include "CommandLineParser.h"
+#include "IndexShards.h"
+#include "QueryLog.h"
+#include "SearchEngine.h"
+
+using namespace std;
+
+void printHelp()
+{
+    cout << "Usage: edareplay -l QUERY_LOG [-d DATABASE | -n SHARDS | -p PORT [-a ADDRESS]] [-k MAX_RESULTS] [-x SPEED] [-o LATENCIES]" << endl;
+    cout << "       edareplay --diff BEFORE_LATENCIES AFTER_LATENCIES" << endl;
+    cout << "SPEED 1 replays at the original rate, 10 ten times faster, 0 as fast as possible." << endl;
+    cout << "MAX_RESULTS must match the edahttpd -k that recorded the log." << endl;
+}
+
+/**
+ * @brief percent-encodes a query so it can be sent in a URL.
+ */
+static string encodeUrl(const string &text)
+{
+    const char *hex = "0123456789ABCDEF";
+    string encoded;
+
+    for (unsigned char c : text)
+    {
+        if (isalnum(c) || c == '-' || c == '_' || c == '.')
+            encoded += c;
+        else
+        {
+            encoded += '%';
+            encoded += hex[c >> 4];
+            encoded += hex[c & 0xF];
+        }
+    }
+
+    return encoded;
+}
+
+/**
+ * @brief sends a GET request and reads the whole response.
+ *
+ * @param address server address
+ * @param port server port
+ * @param path the path to request
+ * @param response the response, headers included
+ * @return false if the server could not be reached
+ */
+static bool httpGet(const string &address, const string &port, const string &path, string &response)
+{
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo *addresses;
+    if (getaddrinfo(address.c_str(), port.c_str(), &hints, &addresses) != 0)
+        return false;
+
+    SocketHandle connection = INVALID_SOCKET;
+    for (addrinfo *i = addresses; i && connection == INVALID_SOCKET; i = i->ai_next)
+    {
+        connection = socket(i->ai_family, i->ai_socktype, i->ai_protocol);
+        if (connection != INVALID_SOCKET && connect(connection, i->ai_addr, (int)i->ai_addrlen) != 0)
+        {
+            closeSocket(connection);
+            connection = INVALID_SOCKET;
+        }
+    }
+    freeaddrinfo(addresses);
+
+    if (connection == INVALID_SOCKET)
+        return false;
+
+    string request = "GET " + path + " HTTP/1.0\r\nHost: " + address + "\r\nConnection: close\r\n\r\n";
+    if (send(connection, request.data(), (int)request.size(), 0) != (int)request.size())
+    {
+        closeSocket(connection);
+        return false;
+    }
+
+    response.clear();
+    char buffer[16384];
+    int received;
+    while ((received = recv(connection, buffer, sizeof(buffer), 0)) > 0)
+        response.append(buffer, received);
+
+    closeSocket(connection);
+
+    return true;
+}
+
+/**
+ * @brief reads the result count out of an EDAoogle results page.
+ */
+static long parseResultCount(const string &response)
+{
+    string marker = "<div class=\"results\">";
+    size_t start = response.find(marker);
+    if (start == string::npos)
+        return -1;
+
+    return strtol(response.c_str() + start + marker.size(), NULL, 10);
+}
+
+static uint32_t percentile(const vector<uint32_t> &sorted, double fraction)
+{
+    if (sorted.empty())
+        return 0;
+
+    return sorted[(size_t)(fraction * (sorted.size() - 1))];
+}
+
+static void printDistribution(const string &name, vector<uint32_t> latencies)
+{
+    sort(latencies.begin(), latencies.end());
+
+    double total = 0;
+    for (uint32_t latency : latencies)
+        total += latency;
+
+    cout << left << setw(10) << name << right
+         << setw(8) << latencies.size()
+         << setw(10) << (latencies.empty() ? 0 : (uint32_t)(total / latencies.size()))
+         << setw(10) << percentile(latencies, 0.5)
+         << setw(10) << percentile(latencies, 0.9)
+         << setw(10) << percentile(latencies, 0.99)
+         << setw(10) << (latencies.empty() ? 0 : latencies.back()) << endl;
+}
+
+static void printHeader()
+{
+    cout << left << setw(10) << "(us)" << right
+         << setw(8) << "count"
+         << setw(10) << "mean"
+         << setw(10) << "p50"
+         << setw(10) << "p90"
+         << setw(10) << "p99"
+         << setw(10) << "max" << endl;
+}
+
+static bool readLatencies(const string &path, vector<uint32_t> &latencies)
+{
+    ifstream file(path);
+    if (!file.is_open())
+        return false;
+
+    uint32_t latency;
+    while (file >> latency)
+        latencies.push_back(latency);
+
+    return true;
+}
+
+/**
+ * @brief compares two latency files written with -o, e.g. from two builds.
+ */
+static int diffLatencies(const string &beforePath, const string &afterPath)
+{
+    vector<uint32_t> before, after;
+    if (!readLatencies(beforePath, before) || !readLatencies(afterPath, after))
+    {
+        cout << "error: can't read latencies." << endl;
+
+        return 1;
+    }
+
+    printHeader();
+    printDistribution("before", before);
+    printDistribution("after", after);
+
+    sort(before.begin(), before.end());
+    sort(after.begin(), after.end());
+
+    cout << left << setw(10) << "change" << right << setw(8) << "";
+    double fractions[] = {0.5, 0.9, 0.99};
+    cout << setw(10) << "";
+    for (double fraction : fractions)
+    {
+        double a = percentile(before, fraction);
+        double b = percentile(after, fraction);
+        string change = (a > 0) ? to_string((int)((b - a) * 100 / a)) + "%" : "-";
+        cout << setw(10) << change;
+    }
+    cout << endl;
+
+    return 0;
+}
+
+int main(int argc, const char *argv[])
+{
+    CommandLineParser parser(argc, argv);
+
+    if (parser.hasOption("--diff"))
+    {
+        if (argc != 4 || string(argv[1]) != "--diff")
+        {
+            printHelp();
+
+            return 1;
+        }
+
+        return diffLatencies(argv[2], argv[3]);
+    }
+
+    if (!parser.hasOption("-l"))
+    {
+        cout << "error: QUERY_LOG must be specified." << endl;
+
+        printHelp();
+
+        return 1;
+    }
+
+    vector<QueryLogEntry> entries;
+    if (!readQueryLog(parser.getOption("-l"), entries))
+    {
+        cout << "error: can't read query log." << endl;
+
+        return 1;
+    }
+
+    // Configuration
+    bool useServer = parser.hasOption("-p");
+    string port = parser.getOption("-p");
+    string address = parser.hasOption("-a") ? parser.getOption("-a") : "127.0.0.1";
+    vector<string> databaseFiles;
+    double speed = parser.hasOption("-x") ? stod(parser.getOption("-x")) : 0;
+    size_t maxResults = parser.hasOption("-k") ? stoul(parser.getOption("-k")) : 0;
+
+    if (parser.hasOption("-n"))
+    {
+        int shardCount = max(1, stoi(parser.getOption("-n")));
+        for (int shard = 0; shard < shardCount; shard++)
+            databaseFiles.push_back(getShardDatabaseFile(shard, shardCount));
+    }
+    else
+        databaseFiles.push_back(parser.hasOption("-d") ? parser.getOption("-d") : "index.db");
+
+#ifdef _WIN32
+    WSADATA wsaData;
+    WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif
+
+    SearchEngine searchEngine(databaseFiles);
+
+    vector<uint32_t> originalLatencies;
+    vector<uint32_t> latencies;
+    size_t mismatches = 0;
+    size_t failures = 0;
+    size_t truncations = 0;
+
+    cout << "Replaying " << entries.size() << " queries against "
+         << (useServer ? address + ":" + port : databaseFiles[0]) << "..." << endl;
+
+    auto replayStart = chrono::steady_clock::now();
+
+    for (auto &entry : entries)
+    {
+        // Keep the original spacing between queries, scaled by speed.
+        if (speed > 0)
+        {
+            auto offset = chrono::microseconds((long long)((entry.timestamp - entries[0].timestamp) / speed));
+            this_thread::sleep_until(replayStart + offset);
+        }
+
+        string query = getQueryLogText(entry);
+        long resultCount = -1;
+
+        auto start = chrono::steady_clock::now();
+
+        if (useServer)
+        {
+            string response;
+            if (httpGet(address, port, "/search?q=" + encodeUrl(query), response))
+                resultCount = parseResultCount(response);
+        }
+        else
+        {
+            // Same as edahttpd: with no results the correction is searched.
+            vector<string> results;
+            SearchStats stats;
+            string suggestion;
+            bool found = searchEngine.search(query, results, &stats, maxResults);
+            if (found && !stats.isTruncated && results.size() < SUGGESTION_MAX_RESULTS &&
+                searchEngine.suggest(query, suggestion) && results.empty())
+                found = searchEngine.search(suggestion, results, NULL, maxResults);
+
+            if (found)
+                resultCount = (long)results.size();
+        }
+
+        auto stop = chrono::steady_clock::now();
+
+        if (resultCount < 0)
+        {
+            failures++;
+            continue;
+        }
+
+        // A truncated query is a different query, only its latency counts.
+        if (isQueryLogTruncated(entry))
+            truncations++;
+        else if (resultCount != (long)entry.resultCount)
+            mismatches++;
+
+        originalLatencies.push_back(useServer ? entry.totalMicros
+                                              : entry.parseMicros + entry.openMicros +
+                                                    entry.evaluateMicros + entry.fetchMicros +
+                                                    entry.suggestMicros);
+        latencies.push_back((uint32_t)chrono::duration_cast<chrono::microseconds>(stop - start).count());
+    }
+
+#ifdef _WIN32
+    WSACleanup();
+#endif
+
+    printHeader();
+    printDistribution("logged", originalLatencies);
+    printDistribution("replayed", latencies);
+
+    cout << failures << " failed queries, "
+         << mismatches << " queries with a different result count, "
+         << truncations << " truncated queries not compared" << endl;
+
+    if (parser.hasOption("-o"))
+    {
+        ofstream output(parser.getOption("-o"));
+        for (uint32_t latency : latencies)
+            output << latency << "\n";
+    }
+
+    return failures ? 1 : 0;
+}
@@ -4,7 +4,7 @@
  * @author Santino Nastasi
  * @author Camila Castro
  * @brief Makes a database index
- * @version 0.3
+ * @version 0.8
  *
  * @copyright Copyright (c) 2022-2024 Marc S. Ressl
  */
@@ -13,13 +13,59 @@
 #include <string>
 #include <filesystem>
 #include <fstream>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include <sqlite3.h>
 
 #include "CommandLineParser.h"
+#include "HtmlScanner.h"
+#include "IndexShards.h"
+#include "PostingCodec.h"
+#include "SpellingIndex.h"
+#include "TextTokenizer.h"
 
 using namespace std;
 
+#define DEFAULT_BLOCK_SIZE 128
+#define DEFAULT_CHECKPOINT_PAGES 100
+
+// Terms in fewer pages are not offered as spelling corrections
+#define SPELLING_MIN_PAGES 2
+
+// The index is built next to the served one and only replaces it once complete.
+#define BUILD_SUFFIX ".building"
+
+struct IndexOptions
+{
+    // Pages between skip pointers
+    size_t blockSize;
+    // Terms in at least this share of the pages (in %) are stored as bitsets, 0 disables them
+    double bitsetPercent;
+    // Pages per committed batch
+    size_t checkpointPages;
+    // Continue a previous run from its last checkpoint
+    bool resume;
+};
+
+static mutex statusMutex;
+
+/**
+ * @brief prints a progress message. Shards are built in parallel, so the
+ * message is printed at once and prefixed with the shard it belongs to.
+ *
+ * @param label the shard, empty for an unsharded index
+ * @param message the message
+ */
+static void printStatus(const string &label, const string &message)
+{
+    lock_guard<mutex> lock(statusMutex);
+    cout << label << message << endl;
+}
+
 static int onDatabaseEntry(void *userdata,
                            int argc,
                            char **argv,
@@ -38,57 +84,27 @@ static int onDatabaseEntry(void *userdata,
 }
 
 /**
- * @brief process the .html files ignoring html tags.
+ * @brief reads an .html file and extracts its text, see extractHtmlText.
  *
  * @param HtmlPath path to the .html
  * @return string containing the processed data
  */
 string processHtmls(filesystem::path HtmlPath)
 {
-
-    string processedText;
-    ifstream html;
-
-    // Open .html using fstream
-    html.open(HtmlPath, std::ios::in);
+    ifstream html(HtmlPath, ios::in | ios::binary);
     if (!html.is_open())
     {
         std::cout << "error opening " << HtmlPath.filename() << std::endl;
         return "";
     }
 
-    // loop until reaching end of file
-    while (!html.eof())
-    {
-        // if it finds a < ignores everything until the closing >
-        if (html.peek() == '<')
-        {
-            html.ignore(std::numeric_limits<std::streamsize>::max(), '>');
-        }
-        else
-        {
-            string line;
-            // If it finds ' it ignores it because its problematic with sql reserved words.
-            while (html.peek() != '<' && !html.eof())
-            {
-                if (html.peek() == '\'')
-                {
-                    html.ignore(1);
-                }
-                else
-                {
-                    line.push_back(html.get());
-                }
-            }
+    // The whole page is read at once, the scanner works on memory.
+    html.seekg(0, ios::end);
+    string data((size_t)html.tellg(), '\0');
+    html.seekg(0, ios::beg);
+    html.read(&data[0], data.size());
 
-            if (!line.empty())
-            {
-                processedText += line;
-            }
-        }
-    }
-
-    return processedText;
+    return extractHtmlText(data);
 }
 
 /**
@@ -116,54 +132,259 @@ string PageNameEditor(string name)
     return finalName;
 }
 
-int main(int argc,
-         const char *argv[])
+/**
+ * @brief writes the spelling correction tables. wiki_spelling_terms numbers
+ * the candidate terms in term order and keeps their page counts, and
+ * wiki_spelling maps each deletion variant to the ids of the terms it comes
+ * from, delta encoded like positions.
+ *
+ * @param database the index database
+ * @param spellingTerms the candidate terms and their page counts, sorted by term
+ * @return false if the tables could not be written
+ */
+static bool writeSpelling(sqlite3 *database, const vector<pair<string, size_t>> &spellingTerms)
 {
+    sqlite3_stmt *termStmt;
+    sqlite3_stmt *variantStmt;
+
+    if (sqlite3_prepare_v2(database,
+                           "INSERT INTO wiki_spelling_terms (id, term, pages) VALUES (?, ?, ?);",
+                           -1,
+                           &termStmt,
+                           NULL) != SQLITE_OK)
+        return false;
+
+    if (sqlite3_prepare_v2(database,
+                           "INSERT INTO wiki_spelling (variant, terms) VALUES (?, ?);",
+                           -1,
+                           &variantStmt,
+                           NULL) != SQLITE_OK)
+    {
+        sqlite3_finalize(termStmt);
+        return false;
+    }
 
-    CommandLineParser parser(argc, argv);
+    bool success = true;
 
-    if (!parser.hasOption("-h"))
+    // Ids grow with the terms, so every list of ids is built already sorted.
+    map<string, vector<uint32_t>> variantTerms;
+    for (uint32_t id = 1; id <= spellingTerms.size() && success; id++)
     {
+        const string &term = spellingTerms[id - 1].first;
 
-        cout << "error: WWW_PATH must be specified." << endl;
+        sqlite3_reset(termStmt);
+        sqlite3_bind_int64(termStmt, 1, id);
+        sqlite3_bind_text(termStmt, 2, term.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int64(termStmt, 3, (sqlite3_int64)spellingTerms[id - 1].second);
+        success = (sqlite3_step(termStmt) == SQLITE_DONE);
 
-        return 1;
+        for (auto &variant : getSpellingVariants(term, SPELLING_MAX_DISTANCE))
+            variantTerms[variant].push_back(id);
     }
 
-    // Takes path from user and opens it with a directory iterator.
+    for (auto &entry : variantTerms)
+    {
+        if (!success)
+            break;
 
-    filesystem::path wwwPath(parser.getOption("-h"));
-    filesystem::path wikiPath = wwwPath.concat("/wiki");
+        string terms = encodePositions(entry.second);
 
-    error_code wikiNotFound;
-    filesystem::directory_iterator wiki(wikiPath, wikiNotFound);
-    if (wikiNotFound)
+        sqlite3_reset(variantStmt);
+        sqlite3_bind_text(variantStmt, 1, entry.first.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_blob(variantStmt, 2, terms.data(), (int)terms.size(), SQLITE_STATIC);
+        success = (sqlite3_step(variantStmt) == SQLITE_DONE);
+    }
+
+    sqlite3_finalize(variantStmt);
+    sqlite3_finalize(termStmt);
+
+    return success;
+}
+
+/**
+ * @brief writes the list of pages containing each term into wiki_postings.
+ * The lists come from wiki_positions, which is already sorted by term and page.
+ *
+ * @param database the index database
+ * @param blockSize pages between skip pointers
+ * @param bitsetPercent terms in at least this share of the pages are stored as bitsets, 0 disables them
+ * @param spellingTerms filled with the terms offered as spelling corrections and their page counts
+ * @return false if the database could not be read or written
+ */
+static bool writePostings(sqlite3 *database,
+                          size_t blockSize,
+                          double bitsetPercent,
+                          vector<pair<string, size_t>> &spellingTerms)
+{
+    sqlite3_stmt *pageCountStmt;
+    sqlite3_stmt *selectStmt;
+    sqlite3_stmt *insertStmt;
+
+    if (sqlite3_prepare_v2(database, "SELECT count(*) FROM wiki_pages;", -1, &pageCountStmt, NULL) != SQLITE_OK)
+        return false;
+
+    double pageCount = 0;
+    if (sqlite3_step(pageCountStmt) == SQLITE_ROW)
+        pageCount = (double)sqlite3_column_int64(pageCountStmt, 0);
+    sqlite3_finalize(pageCountStmt);
+
+    if (sqlite3_prepare_v2(database,
+                           "SELECT term, page FROM wiki_positions ORDER BY term, page;",
+                           -1,
+                           &selectStmt,
+                           NULL) != SQLITE_OK)
+        return false;
+
+    if (sqlite3_prepare_v2(database,
+                           "INSERT INTO wiki_postings (term, postings) VALUES (?, ?);",
+                           -1,
+                           &insertStmt,
+                           NULL) != SQLITE_OK)
     {
+        sqlite3_finalize(selectStmt);
+        return false;
+    }
 
-        cout << "error WIKI not founded." << endl;
+    string term;
+    vector<uint32_t> pages;
+    bool success = true;
 
-        return 1;
+    while (true)
+    {
+        bool hasRow = (sqlite3_step(selectStmt) == SQLITE_ROW);
+        string rowTerm = hasRow ? (const char *)sqlite3_column_text(selectStmt, 0) : "";
+
+        // The previous term is complete, write it.
+        if (!pages.empty() && (!hasRow || rowTerm != term))
+        {
+            bool isFrequent = bitsetPercent > 0 && pages.size() * 100.0 >= bitsetPercent * pageCount;
+            string postings = isFrequent ? encodeBitsetPostings(pages)
+                                         : encodeBlockPostings(pages, blockSize);
+
+            sqlite3_reset(insertStmt);
+            sqlite3_bind_text(insertStmt, 1, term.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_blob(insertStmt, 2, postings.data(), (int)postings.size(), SQLITE_STATIC);
+
+            if (sqlite3_step(insertStmt) != SQLITE_DONE)
+                success = false;
+
+            if (pages.size() >= SPELLING_MIN_PAGES && isSpellingTerm(term))
+                spellingTerms.push_back({term, pages.size()});
+
+            pages.clear();
+        }
+
+        if (!hasRow)
+            break;
+
+        term = rowTerm;
+        pages.push_back((uint32_t)sqlite3_column_int64(selectStmt, 1));
     }
 
+    sqlite3_finalize(insertStmt);
+    sqlite3_finalize(selectStmt);
+
+    return success;
+}
+
+/**
+ * @brief reads the last page committed by a previous run.
+ *
+ * @param database the index database being built
+ * @return the file name of the page, or an empty string if there is none
+ */
+static string readProgress(sqlite3 *database)
+{
+    sqlite3_stmt *stmt;
+    string lastFile;
+
+    if (sqlite3_prepare_v2(database,
+                           "SELECT lastFile FROM index_progress WHERE id = 0;",
+                           -1,
+                           &stmt,
+                           NULL) != SQLITE_OK)
+        return "";
+
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+        lastFile = (const char *)sqlite3_column_text(stmt, 0);
+
+    sqlite3_finalize(stmt);
+
+    return lastFile;
+}
+
+/**
+ * @brief records the last page of the batch being committed.
+ *
+ * @param database the index database being built
+ * @param lastFile file name of the page
+ * @return false if it could not be recorded
+ */
+static bool writeProgress(sqlite3 *database, const string &lastFile)
+{
+    sqlite3_stmt *stmt;
+
+    if (sqlite3_prepare_v2(database,
+                           "INSERT OR REPLACE INTO index_progress (id, lastFile) VALUES (0, ?);",
+                           -1,
+                           &stmt,
+                           NULL) != SQLITE_OK)
+        return false;
+
+    sqlite3_bind_text(stmt, 1, lastFile.c_str(), -1, SQLITE_STATIC);
+    bool success = (sqlite3_step(stmt) == SQLITE_DONE);
+    sqlite3_finalize(stmt);
+
+    return success;
+}
+
+/**
+ * @brief builds one index database out of the given pages.
+ *
+ * @param files the pages, sorted by file name
+ * @param databaseFile where the finished index is installed
+ * @param options build options
+ * @param label prefix for progress messages
+ * @return true if the index was built and installed
+ */
+static bool buildIndex(const vector<filesystem::path> &files,
+                       const string &databaseFile,
+                       const IndexOptions &options,
+                       const string &label)
+{
     // database variables.
 
-    char *databaseFile = (char *)"index.db";
+    string buildFile = databaseFile + BUILD_SUFFIX;
     sqlite3 *database;
     char *databaseErrorMessage;
 
+    bool resume = options.resume;
+    if (resume && !filesystem::exists(buildFile))
+    {
+        printStatus(label, "Nothing to resume, starting from scratch...");
+        resume = false;
+    }
+
+    if (!resume)
+    {
+        error_code removeError;
+        filesystem::remove(buildFile, removeError);
+        filesystem::remove(buildFile + "-journal", removeError);
+    }
+
     // Open database file
-    cout << "Opening database..." << endl;
-    if (sqlite3_open(databaseFile, &database) != SQLITE_OK)
+    printStatus(label, "Opening database...");
+    if (sqlite3_open(buildFile.c_str(), &database) != SQLITE_OK)
     {
-        cout << "Can't open database: " << sqlite3_errmsg(database) << endl;
+        printStatus(label, string("Can't open database: ") + sqlite3_errmsg(database));
 
-        return 1;
+        return false;
     }
 
     // Create the wiki_pages table
-    cout << "Creating table..." << endl;
+    printStatus(label, "Creating table...");
     if (sqlite3_exec(database,
-                     "CREATE TABLE wiki_pages"
+                     "CREATE TABLE IF NOT EXISTS wiki_pages"
                      "(id INTEGER PRIMARY KEY,"
                      " page varchar DEFAULT NULL,"
                      " pageText text DEFAULT NULL);",
@@ -171,55 +392,106 @@ int main(int argc,
                      0,
                      &databaseErrorMessage) != SQLITE_OK)
     {
-        cout << "Error: " << sqlite3_errmsg(database) << endl;
+        printStatus(label, string("Error: ") + sqlite3_errmsg(database));
+    }
+
+    // Create the wiki_positions table, the positional index used by phrase and NEAR queries
+    printStatus(label, "Creating positional table...");
+    if (sqlite3_exec(database,
+                     "CREATE TABLE IF NOT EXISTS wiki_positions"
+                     "(term text NOT NULL,"
+                     " page INTEGER NOT NULL,"
+                     " positions blob NOT NULL,"
+                     " PRIMARY KEY (term, page)) WITHOUT ROWID;",
+                     NULL,
+                     0,
+                     &databaseErrorMessage) != SQLITE_OK)
+    {
+        printStatus(label, string("Error: ") + sqlite3_errmsg(database));
     }
 
-    // Create the wiki_pages_fts virtual table using fts5
-    cout << "Creating virtual table..." << endl;
+    // Create the wiki_postings table, the pages containing each term
+    printStatus(label, "Creating postings table...");
     if (sqlite3_exec(database,
-                     "CREATE VIRTUAL TABLE wiki_pages_fts USING fts5 "
-                     "(page_name,"
-                     " content);",
+                     "CREATE TABLE IF NOT EXISTS wiki_postings"
+                     "(term text PRIMARY KEY,"
+                     " postings blob NOT NULL) WITHOUT ROWID;",
                      NULL,
                      0,
                      &databaseErrorMessage) != SQLITE_OK)
     {
-        cout << "Error: " << sqlite3_errmsg(database) << endl;
+        printStatus(label, string("Error: ") + sqlite3_errmsg(database));
     }
 
-    // Delete previous entries if table already existed
-    cout << "Deleting previous entries..." << endl;
+    // Create the spelling tables, the deletion variants used to correct misspelled terms
+    printStatus(label, "Creating spelling tables...");
     if (sqlite3_exec(database,
-                     "DELETE FROM wiki_pages;",
+                     "CREATE TABLE IF NOT EXISTS wiki_spelling_terms"
+                     "(id INTEGER PRIMARY KEY,"
+                     " term text NOT NULL,"
+                     " pages INTEGER NOT NULL);"
+                     "CREATE TABLE IF NOT EXISTS wiki_spelling"
+                     "(variant text PRIMARY KEY,"
+                     " terms blob NOT NULL) WITHOUT ROWID;",
                      NULL,
                      0,
                      &databaseErrorMessage) != SQLITE_OK)
     {
-        cout << "Error: " << sqlite3_errmsg(database) << endl;
+        printStatus(label, string("Error: ") + sqlite3_errmsg(database));
     }
 
-    // Delete previous entries if the virtual table.
-    cout << "Deleting previous entries..." << endl;
+    // Create the index_progress table, the last page of the last checkpoint
+    printStatus(label, "Creating progress table...");
     if (sqlite3_exec(database,
-                     "DELETE FROM wiki_pages_fts;",
+                     "CREATE TABLE IF NOT EXISTS index_progress"
+                     "(id INTEGER PRIMARY KEY,"
+                     " lastFile text NOT NULL);",
                      NULL,
                      0,
                      &databaseErrorMessage) != SQLITE_OK)
     {
-        cout << "Error: " << sqlite3_errmsg(database) << endl;
+        printStatus(label, string("Error: ") + sqlite3_errmsg(database));
     }
 
+    string lastFile;
+    if (resume)
+        lastFile = readProgress(database);
+
+    if (!lastFile.empty())
+        printStatus(label, string("Resuming after ") + lastFile + "...");
+
     // Create sample entries
-    cout << "Creating entries..." << endl;
+    printStatus(label, "Creating entries...");
 
     sqlite3_stmt *stmt;
+    sqlite3_stmt *positionsStmt;
+
+    if (sqlite3_prepare_v2(database,
+                           "INSERT INTO wiki_positions (term, page, positions) VALUES (?, ?, ?);",
+                           -1,
+                           &positionsStmt,
+                           NULL) != SQLITE_OK)
+    {
+        printStatus(label, string("Error: ") + sqlite3_errmsg(database));
+
+        return false;
+    }
+
+    // Pages are inserted in batches of options.checkpointPages, each one a single
+    // transaction that also records the last page it holds.
+    size_t batchPages = 0;
+    sqlite3_exec(database, "BEGIN;", NULL, 0, &databaseErrorMessage);
 
     // The for iterates through every .html file in wiki/www
-    for (auto file : wiki)
+    for (auto &file : files)
     {
+        string fileName = file.filename().string();
+        if (!lastFile.empty() && fileName <= lastFile)
+            continue;
+
         // For each file, saves page name and text.
-        string pageName = PageNameEditor(file.path().filename());
-        string text = processHtmls(file.path());
+        string pageName = PageNameEditor(fileName);
+        string text = processHtmls(file);
 
         // Then saves it in the database, done in two steps for safety reasons (more details in README.md).
         if (!text.empty())
@@ -230,28 +502,223 @@ int main(int argc,
                                    -1,
                                    &stmt,
                                    NULL) != SQLITE_OK)
-                cout << "Error: " << sqlite3_errmsg(database) << endl;
+                printStatus(label, string("Error: ") + sqlite3_errmsg(database));
 
             else if (sqlite3_bind_text(stmt, 1, pageName.c_str(), -1, SQLITE_STATIC) != SQLITE_OK || sqlite3_bind_text(stmt, 2, text.c_str(), -1, SQLITE_STATIC) != SQLITE_OK)
-                cout << "Error: " << sqlite3_errmsg(database) << endl;
+                printStatus(label, string("Error: ") + sqlite3_errmsg(database));
 
             if (sqlite3_step(stmt) != SQLITE_DONE)
-                cout << "Error: " << sqlite3_errmsg(database) << endl;
+                printStatus(label, string("Error: ") + sqlite3_errmsg(database));
 
             sqlite3_finalize(stmt);
+
+            // Positional index: where each term appears inside the page.
+            sqlite3_int64 page = sqlite3_last_insert_rowid(database);
+
+            map<string, vector<uint32_t>> termPositions;
+            vector<string> terms = tokenizeText(text);
+            for (uint32_t position = 0; position < terms.size(); position++)
+                termPositions[terms[position]].push_back(position);
+
+            for (auto &entry : termPositions)
+            {
+                string positions = encodePositions(entry.second);
+
+                sqlite3_reset(positionsStmt);
+                sqlite3_bind_text(positionsStmt, 1, entry.first.c_str(), -1, SQLITE_STATIC);
+                sqlite3_bind_int64(positionsStmt, 2, page);
+                sqlite3_bind_blob(positionsStmt, 3, positions.data(), (int)positions.size(), SQLITE_STATIC);
+
+                if (sqlite3_step(positionsStmt) != SQLITE_DONE)
+                    printStatus(label, string("Error: ") + sqlite3_errmsg(database));
+            }
+        }
+
+        if (++batchPages == options.checkpointPages)
+        {
+            if (!writeProgress(database, fileName) ||
+                sqlite3_exec(database, "COMMIT;", NULL, 0, &databaseErrorMessage) != SQLITE_OK)
+            {
+                printStatus(label, string("Error: ") + sqlite3_errmsg(database));
+                sqlite3_close(database);
+
+                return false;
+            }
+
+            printStatus(label, string("Checkpoint after ") + fileName);
+            batchPages = 0;
+            sqlite3_exec(database, "BEGIN;", NULL, 0, &databaseErrorMessage);
         }
     }
 
-    // Copy table to the virtual table that uses fts.
-    cout << "Copying entries to virtual table..." << endl;
-    if (sqlite3_exec(database,
-                     "INSERT INTO wiki_pages_fts (rowid, page_name, content) SELECT id, page, pageText FROM wiki_pages",
-                     NULL,
-                     0,
-                     &databaseErrorMessage) != SQLITE_OK)
-        cout << "Error: " << sqlite3_errmsg(database) << endl;
+    sqlite3_finalize(positionsStmt);
+
+    if (!files.empty() && batchPages > 0)
+        writeProgress(database, files.back().filename().string());
+
+    if (sqlite3_exec(database, "COMMIT;", NULL, 0, &databaseErrorMessage) != SQLITE_OK)
+    {
+        printStatus(label, string("Error: ") + sqlite3_errmsg(database));
+        sqlite3_close(database);
+
+        return false;
+    }
+
+    // Build the page lists and spelling tables out of the positional index. Done from scratch on
+    // every run, so a run that died while writing them just starts over.
+    printStatus(label, "Writing postings...");
+    sqlite3_exec(database, "BEGIN;", NULL, 0, &databaseErrorMessage);
+    sqlite3_exec(database, "DELETE FROM wiki_postings;", NULL, 0, &databaseErrorMessage);
+    sqlite3_exec(database, "DELETE FROM wiki_spelling_terms;", NULL, 0, &databaseErrorMessage);
+    sqlite3_exec(database, "DELETE FROM wiki_spelling;", NULL, 0, &databaseErrorMessage);
+
+    vector<pair<string, size_t>> spellingTerms;
+    if (!writePostings(database, options.blockSize, options.bitsetPercent, spellingTerms) ||
+        !writeSpelling(database, spellingTerms) ||
+        sqlite3_exec(database, "COMMIT;", NULL, 0, &databaseErrorMessage) != SQLITE_OK)
+    {
+        printStatus(label, string("Error: ") + sqlite3_errmsg(database));
+        sqlite3_close(database);
+
+        return false;
+    }
 
     // Close database
-    cout << "Closing database..." << endl;
+    printStatus(label, "Closing database...");
     sqlite3_close(database);
+
+    // Replace the served index in one step, edahttpd sees either the old or the new one.
+    printStatus(label, "Installing index...");
+    error_code renameError;
+    filesystem::rename(buildFile, databaseFile, renameError);
+    if (renameError)
+    {
+        printStatus(label, string("Error: ") + renameError.message());
+
+        return false;
+    }
+
+    return true;
+}
+
+int main(int argc,
+         const char *argv[])
+{
+
+    CommandLineParser parser(argc, argv);
+
+    if (!parser.hasOption("-h"))
+    {
+
+        cout << "error: WWW_PATH must be specified." << endl;
+        cout << "Usage: mkindex -h WWW_PATH [-n SHARDS [-i SHARD]] [--resume] [-c CHECKPOINT_PAGES] [-s SKIP_INTERVAL] [-b BITSET_PERCENT]" << endl;
+
+        return 1;
+    }
+
+    // Postings options: pages per skip block, and share of the pages (in %)
+    // from which a term is stored as a bitset (0 disables bitsets).
+    IndexOptions options;
+    options.blockSize = DEFAULT_BLOCK_SIZE;
+    options.bitsetPercent = 0;
+
+    if (parser.hasOption("-s"))
+        options.blockSize = stoul(parser.getOption("-s"));
+    if (parser.hasOption("-b"))
+        options.bitsetPercent = stod(parser.getOption("-b"));
+
+    if (options.blockSize == 0)
+    {
+        cout << "error: SKIP_INTERVAL must be positive." << endl;
+
+        return 1;
+    }
+
+    // Progress is committed every checkpointPages pages. With --resume a
+    // previous run that died continues from its last checkpoint.
+    options.checkpointPages = DEFAULT_CHECKPOINT_PAGES;
+    options.resume = parser.hasOption("--resume");
+
+    if (parser.hasOption("-c"))
+        options.checkpointPages = stoul(parser.getOption("-c"));
+
+    if (options.checkpointPages == 0)
+    {
+        cout << "error: CHECKPOINT_PAGES must be positive." << endl;
+
+        return 1;
+    }
+
+    // With -n the pages are split into shards by name, each one its own
+    // index-N.db. All shards are built in parallel, or only shard -i.
+    int shardCount = 1;
+    int onlyShard = -1;
+
+    if (parser.hasOption("-n"))
+        shardCount = stoi(parser.getOption("-n"));
+    if (parser.hasOption("-i"))
+        onlyShard = stoi(parser.getOption("-i"));
+
+    if (shardCount < 1 || onlyShard >= shardCount)
+    {
+        cout << "error: SHARD must be lower than SHARDS." << endl;
+
+        return 1;
+    }
+
+    // Takes path from user and opens it with a directory iterator.
+
+    filesystem::path wwwPath(parser.getOption("-h"));
+    filesystem::path wikiPath = wwwPath.concat("/wiki");
+
+    error_code wikiNotFound;
+    filesystem::directory_iterator wiki(wikiPath, wikiNotFound);
+    if (wikiNotFound)
+    {
+
+        cout << "error WIKI not founded." << endl;
+
+        return 1;
+    }
+
+    // Pages are indexed in name order, so a resumed run knows which ones are done.
+    vector<filesystem::path> files;
+    for (auto file : wiki)
+        files.push_back(file.path());
+    sort(files.begin(), files.end(),
+         [](const filesystem::path &a, const filesystem::path &b)
+         { return a.filename() < b.filename(); });
+
+    vector<vector<filesystem::path>> shardFiles(shardCount);
+    for (auto &file : files)
+        shardFiles[getPageShard(file.filename().string(), shardCount)].push_back(file);
+
+    if (shardCount == 1)
+        return buildIndex(files, getShardDatabaseFile(0, 1), options, "") ? 0 : 1;
+
+    if (onlyShard >= 0)
+        return buildIndex(shardFiles[onlyShard],
+                          getShardDatabaseFile(onlyShard, shardCount),
+                          options,
+                          "[shard " + to_string(onlyShard) + "] ")
+                   ? 0
+                   : 1;
+
+    // One worker per shard, each with its own database connection.
+    vector<thread> workers;
+    vector<char> succeeded(shardCount, 0);
+
+    for (int shard = 0; shard < shardCount; shard++)
+    {
+        workers.emplace_back([&, shard]()
+                             { succeeded[shard] = buildIndex(shardFiles[shard],
+                                                             getShardDatabaseFile(shard, shardCount),
+                                                             options,
+                                                             "[shard " + to_string(shard) + "] "); });
+    }
+
+    for (auto &worker : workers)
+        worker.join();
+
+    return count(succeeded.begin(), succeeded.end(), 1) == shardCount ? 0 : 1;
 }